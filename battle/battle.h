@@ -1,7 +1,8 @@
 #ifndef JNP_STAR_WARS_BATTLE_H
 #define JNP_STAR_WARS_BATTLE_H
 
-#include <tuple>
+#include <array>
+#include <utility>
 #include <algorithm>
 #include <iostream>
 
@@ -9,28 +10,99 @@
 #include "imperialfleet.h"
 
 namespace jnp_sw_ {
+    template<size_t i, typename T>
+    struct TupleLeaf {
+        T value;
+    };
+
+    template<typename Indices, typename... Ts>
+    struct FlatTupleBase;
+
+    template<size_t... i, typename... Ts>
+    struct FlatTupleBase<std::index_sequence<i...>, Ts...> : TupleLeaf<i, Ts>... {
+        constexpr FlatTupleBase(Ts... t) : TupleLeaf<i, Ts>{t}... {}
+    };
+
+    // Tuple inheriting directly from one leaf per element. Unlike std::tuple,
+    // neither construction nor get<i> recurses over the elements, so fleets
+    // of hundreds of ships stay cheap to compile.
+    template<typename... Ts>
+    struct FlatTuple : FlatTupleBase<std::index_sequence_for<Ts...>, Ts...> {
+        using FlatTupleBase<std::index_sequence_for<Ts...>, Ts...>::FlatTupleBase;
+    };
+
+    template<size_t i, typename T>
+    constexpr T &get(TupleLeaf<i, T> &leaf) {
+        return leaf.value;
+    }
+
+    template<size_t i, typename T>
+    constexpr const T &get(const TupleLeaf<i, T> &leaf) {
+        return leaf.value;
+    }
+
+    // Positions of the types among Ts satisfying Predicate, in order.
+    template<template<typename> class Predicate, typename... Ts>
+    constexpr auto selectedIndices() {
+        constexpr bool selected[] = {Predicate<Ts>()..., false};
+        std::array<size_t, (size_t(0) + ... + size_t(Predicate<Ts>()))> ans{};
+        size_t j = 0;
+        for (size_t i = 0; i < sizeof...(Ts); ++i) {
+            if (selected[i])
+                ans[j++] = i;
+        }
+        return ans;
+    }
+
     template<template<typename> class Predicate, typename... Ts>
     class TupleFilter {
-        template<class T>
-        static auto filterOne(T t) {
-            if constexpr (Predicate<T>()) {
-                return std::tuple<T>(t);
-            } else {
-                return std::tuple<>();
-            }
+        static constexpr auto indices = selectedIndices<Predicate, Ts...>();
+
+        template<size_t... i>
+        static constexpr auto filter(const FlatTuple<Ts...> &t, std::index_sequence<i...>) {
+            return FlatTuple<std::decay_t<decltype(get<indices[i]>(t))>...>(get<indices[i]>(t)...);
         }
 
     public:
-        static auto filter(Ts... t) {
-            return std::tuple_cat(filterOne(t)...);
+        static constexpr auto filter(Ts... t) {
+            return filter(FlatTuple<Ts...>(t...), std::make_index_sequence<indices.size()>());
         }
 
         using ResultTupleType = decltype(filter(std::declval<Ts>()...));
 
         constexpr static size_t size() {
-            return std::tuple_size<ResultTupleType>();
+            return indices.size();
         }
     };
+
+    template<typename T, size_t n>
+    constexpr size_t lowerBound(const std::array<T, n> &values, size_t first, T value) {
+        size_t last = n;
+        while (first < last) {
+            size_t mid = first + (last - first) / 2;
+            if (values[mid] < value)
+                first = mid + 1;
+            else
+                last = mid;
+        }
+        return first;
+    }
+}
+
+enum class BattleStatus {
+    InProgress,
+    Draw,
+    ImperiumWon,
+    RebellionWon
+};
+
+inline void printBattleStatus(BattleStatus status) {
+    switch (status) {
+        case BattleStatus::InProgress: break;
+        case BattleStatus::Draw: std::cout << "DRAW\n"; break;
+        case BattleStatus::ImperiumWon: std::cout << "IMPERIUM WON\n"; break;
+        case BattleStatus::RebellionWon: std::cout << "REBELLION WON\n"; break;
+    }
 }
 
 template<typename T, T t0, T t1, typename... S>
@@ -40,36 +112,53 @@ class SpaceBattle {
     typename ImperialFilter::ResultTupleType imperialShips;
     typename RebelFilter::ResultTupleType rebelShips;
     T time;
+    size_t imperialAlive;
+    size_t rebelAlive;
+    // Index of the smallest square not less than time.
+    size_t nextSquare;
+
+public:
+    // Called by tick() with the outcome of a finished battle.
+    using Observer = void (*)(BattleStatus);
+
+private:
+    Observer observer = printBattleStatus;
 
     static_assert(sizeof...(S) == ImperialFilter::size() + RebelFilter::size(),
                   "Non-starship arguments for SpaceBattle");
     static_assert(t0 <= t1, "SpaceBattle: t0 > t1");
     static_assert(t0 >= 0, "SpaceBattle: t0 < 0");
 
-    template<size_t i = 0, typename ...Ts>
-    size_t countAlive(const std::tuple<Ts...> &shipList) const {
-        if constexpr (i < sizeof...(Ts))
-            return (std::get<i>(shipList).getShield() > 0) +
-                   countAlive<i + 1, Ts...>(shipList);
-        else
-            return 0;
-    }
-
-    template<size_t i = 0>
-    void attackAll() {
-        if constexpr (i < ImperialFilter::size()) {
-            if (std::get<i>(imperialShips).getShield() > 0)
-                attackOne(std::get<i>(imperialShips));
-            attackAll<i + 1>();
+    template<typename Ships, size_t... i>
+    static constexpr size_t countAlive(const Ships &shipList, std::index_sequence<i...>) {
+        return (size_t(0) + ... + size_t(jnp_sw_::get<i>(shipList).getShield() > 0));
+    }
+
+    template<size_t... i>
+    constexpr void attackAll(std::index_sequence<i...>) {
+        (attackOne(jnp_sw_::get<i>(imperialShips), std::make_index_sequence<RebelFilter::size()>()), ...);
+    }
+
+    constexpr void attackAll() {
+        attackAll(std::make_index_sequence<ImperialFilter::size()>());
+    }
+
+    // The imperial ship keeps fighting after its shield drops to 0, and a
+    // negative return fire may raise it again, so its state is compared only
+    // before and after the whole row.
+    template<typename I, size_t... i>
+    constexpr void attackOne(I &imperialShip, std::index_sequence<i...>) {
+        if (imperialShip.getShield() > 0) {
+            (attackPair(imperialShip, jnp_sw_::get<i>(rebelShips)), ...);
+            imperialAlive -= !(imperialShip.getShield() > 0);
         }
     }
 
-    template<size_t i = 0, typename I>
-    void attackOne(I& imperialShip) {
-        if constexpr (i < RebelFilter::size()) {
-            if (std::get<i>(rebelShips).getShield() > 0)
-                attack(imperialShip, std::get<i>(rebelShips));
-            attackOne<i + 1>(imperialShip);
+    template<typename I, typename R>
+    constexpr void attackPair(I &imperialShip, R &rebelShip) {
+        if (rebelShip.getShield() > 0) {
+            attack(imperialShip, rebelShip);
+            rebelAlive -= !(rebelShip.getShield() > 0);
         }
     }
 
@@ -91,39 +180,113 @@ class SpaceBattle {
 
     static constexpr auto squares = squaresArray();
 
+    constexpr bool isAttackTime() const {
+        return nextSquare < squares.size() && squares[nextSquare] == time;
+    }
+
+    constexpr void moveTime(T delta) {
+        T previous = time;
+        time += delta;
+        time %= (t1 + 1);
+        nextSquare = jnp_sw_::lowerBound(squares, time < previous ? 0 : nextSquare, time);
+    }
+
+    // Number of ticks (at least 1, at most limit) that can be skipped without
+    // reaching an attack time, assuming the current time is not one.
+    constexpr size_t idleTicks(T timeStep, size_t limit) const {
+        if (timeStep <= 0)
+            return timeStep == 0 ? limit : 1;
+
+        // Ticks left until time wraps around t1.
+        T lap = (t1 - time) / timeStep + 1;
+        for (size_t i = nextSquare; i < squares.size(); ++i) {
+            if ((squares[i] - time) % timeStep == 0) {
+                lap = (squares[i] - time) / timeStep;
+                break;
+            }
+        }
+        return std::min(static_cast<size_t>(lap), limit);
+    }
+
 public:
-    SpaceBattle(S... ships) :
+    constexpr SpaceBattle(S... ships) :
             imperialShips(ImperialFilter::filter(ships...)),
             rebelShips(RebelFilter::filter(ships...)),
-            time(t0) {}
+            time(t0),
+            imperialAlive(countAlive(imperialShips, std::make_index_sequence<ImperialFilter::size()>())),
+            rebelAlive(countAlive(rebelShips, std::make_index_sequence<RebelFilter::size()>())),
+            nextSquare(jnp_sw_::lowerBound(squares, 0, t0)) {}
+
+    constexpr size_t countRebelFleet() const {
+        return rebelAlive;
+    }
+
+    constexpr size_t countImperialFleet() const {
+        return imperialAlive;
+    }
+
+    constexpr BattleStatus status() const {
+        if (rebelAlive == 0 && imperialAlive == 0)
+            return BattleStatus::Draw;
+        else if (rebelAlive == 0)
+            return BattleStatus::ImperiumWon;
+        else if (imperialAlive == 0)
+            return BattleStatus::RebellionWon;
+        return BattleStatus::InProgress;
+    }
 
-    size_t countRebelFleet() const {
-        return countAlive(rebelShips);
+    constexpr bool isFinished() const {
+        return status() != BattleStatus::InProgress;
     }
 
-    size_t countImperialFleet() const {
-        return countAlive(imperialShips);
+    // Sets the observer notified by every tick() on a finished battle. By
+    // default the outcome is printed; nullptr disables all output.
+    constexpr void setObserver(Observer o) {
+        observer = o;
     }
 
-    void tick(T timeStep) {
-        size_t rebelCount = countRebelFleet();
-        size_t imperialCount = countImperialFleet();
-        if (rebelCount == 0 && imperialCount == 0) {
-            std::cout << "DRAW" << std::endl;
-            return;
-        } else if (rebelCount == 0) {
-            std::cout << "IMPERIUM WON" << std::endl;
-            return;
-        } else if (imperialCount == 0) {
-            std::cout << "REBELLION WON" << std::endl;
-            return;
+    // Simulates up to steps ticks, jumping over ticks without an attack, and
+    // returns the number of ticks simulated. Stops early, without printing,
+    // when the battle is over. Usable in constant expressions, so a battle of
+    // literal ships can be simulated at compile time, e.g.
+    //
+    //     constexpr auto battle = [] {
+    //         SpaceBattle<int, 0, 100, XWing<int>, TIEFighter<int>> b(
+    //                 XWing<int>(100, 300000, 50), TIEFighter<int>(90, 10));
+    //         b.advance(1000, 1);
+    //         return b;
+    //     }();
+    //     static_assert(battle.countImperialFleet() == 0);
+    constexpr size_t advance(size_t steps, T timeStep) {
+        size_t done = 0;
+        while (done < steps && !isFinished()) {
+            if (isAttackTime()) {
+                attackAll();
+                moveTime(timeStep);
+                ++done;
+            } else {
+                size_t idle = idleTicks(timeStep, steps - done);
+                moveTime(static_cast<T>(idle) * timeStep);
+                done += idle;
+            }
         }
+        return done;
+    }
 
-        if (std::binary_search(squares.begin(), squares.end(), time))
+    // Simulates one tick and returns the resulting status. A finished battle
+    // is not changed; its outcome is passed to the observer instead.
+    constexpr BattleStatus tick(T timeStep) {
+        if (isFinished()) {
+            if (observer != nullptr)
+                observer(status());
+            return status();
+        }
+
+        if (isAttackTime())
             attackAll();
 
-        time += timeStep;
-        time %= (t1 + 1);
+        moveTime(timeStep);
+        return status();
     }
 };
 
@@ -0,0 +1,257 @@
+// Compares SpaceBattle and RuntimeSpaceBattle with a direct simulation of
+// the attack rules on random fleets, including armed rebels with negative
+// attack power, which can raise the shield of a destroyed imperial ship.
+// Also checks that runBattles gives the same report on any number of
+// threads and that a battle can be simulated at compile time.
+//
+// g++ -std=c++17 -O2 -pthread battle_test.cc -o battle_test
+// g++ -std=c++17 -O2 -pthread -mavx2 battle_test.cc -o battle_test_avx2
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "battle.h"
+#include "battlerunner.h"
+#include "runtimebattle.h"
+
+namespace {
+
+// Ships in the order of the SpaceBattle arguments; rebels have armed set
+// to 0 or 1, imperial ships have it set to -1.
+struct Ship {
+    int shield;
+    int attack;
+    int armed;
+};
+
+class ReferenceBattle {
+    std::vector<Ship> ships;
+    int t1;
+    int time;
+
+    static bool isSquare(int t) {
+        for (int i = 0; i * i <= t; ++i) {
+            if (i * i == t)
+                return true;
+        }
+        return false;
+    }
+
+    size_t count(bool imperial) const {
+        size_t ans = 0;
+        for (const Ship &s : ships)
+            ans += (s.armed < 0) == imperial && s.shield > 0;
+        return ans;
+    }
+
+public:
+    ReferenceBattle(std::vector<Ship> ships, int t0, int t1)
+            : ships(std::move(ships)), t1(t1), time(t0) {}
+
+    size_t countImperialFleet() const {
+        return count(true);
+    }
+
+    size_t countRebelFleet() const {
+        return count(false);
+    }
+
+    void tick(int timeStep) {
+        if (countImperialFleet() == 0 || countRebelFleet() == 0)
+            return;
+        if (isSquare(time)) {
+            for (Ship &imperial : ships) {
+                if (imperial.armed >= 0 || imperial.shield <= 0)
+                    continue;
+                for (Ship &rebel : ships) {
+                    if (rebel.armed < 0 || rebel.shield <= 0)
+                        continue;
+                    rebel.shield = rebel.shield > imperial.attack ? rebel.shield - imperial.attack : 0;
+                    if (rebel.armed)
+                        imperial.shield = imperial.shield > rebel.attack ? imperial.shield - rebel.attack : 0;
+                }
+            }
+        }
+        time += timeStep;
+        time %= (t1 + 1);
+    }
+};
+
+int failures = 0;
+
+// The example from the comment on SpaceBattle::advance.
+constexpr auto compileTimeBattle = [] {
+    SpaceBattle<int, 0, 100, XWing<int>, TIEFighter<int>> b(
+            XWing<int>(100, 300000, 50), TIEFighter<int>(90, 10));
+    b.advance(1000, 1);
+    return b;
+}();
+static_assert(compileTimeBattle.countImperialFleet() == 0);
+static_assert(compileTimeBattle.countRebelFleet() == 1);
+static_assert(compileTimeBattle.status() == BattleStatus::RebellionWon);
+
+template<typename B>
+bool same(const B &battle, const ReferenceBattle &reference) {
+    return battle.countImperialFleet() == reference.countImperialFleet() &&
+           battle.countRebelFleet() == reference.countRebelFleet();
+}
+
+template<int t1>
+void compare(std::mt19937 &rng, int minRebelAttack) {
+    auto random = [&rng](int lo, int hi) {
+        return std::uniform_int_distribution<int>(lo, hi)(rng);
+    };
+    auto rebelAttack = [&] { return random(minRebelAttack, 60); };
+
+    XWing<int> x1(random(0, 300), 300000, rebelAttack());
+    Explorer<int> e1(random(0, 300), 300000);
+    TIEFighter<int> f1(random(0, 300), random(0, 40));
+    StarCruiser<int> c1(random(0, 300), 100000, rebelAttack());
+    DeathStar<int> d1(random(0, 600), random(0, 80));
+    XWing<int> x2(random(0, 300), 300000, rebelAttack());
+    ImperialDestroyer<int> i1(random(0, 400), random(0, 60));
+
+    std::vector<Ship> ships = {
+        {x1.getShield(), x1.getAttackPower(), 1},
+        {e1.getShield(), 0, 0},
+        {f1.getShield(), f1.getAttackPower(), -1},
+        {c1.getShield(), c1.getAttackPower(), 1},
+        {d1.getShield(), d1.getAttackPower(), -1},
+        {x2.getShield(), x2.getAttackPower(), 1},
+        {i1.getShield(), i1.getAttackPower(), -1},
+    };
+
+    SpaceBattle<int, 0, t1, XWing<int>, Explorer<int>, TIEFighter<int>, StarCruiser<int>,
+                DeathStar<int>, XWing<int>, ImperialDestroyer<int>>
+            battle(x1, e1, f1, c1, d1, x2, i1);
+    battle.setObserver(nullptr);
+    ReferenceBattle reference(ships, 0, t1);
+
+    int timeStep = random(0, 3) == 0 ? random(-3, 3) : random(1, 2 * t1);
+    bool useAdvance = random(0, 1);
+    for (int k = 0; k < 200; ++k) {
+        if (useAdvance) {
+            size_t steps = static_cast<size_t>(random(1, 20));
+            size_t done = battle.advance(steps, timeStep);
+            for (size_t j = 0; j < done; ++j)
+                reference.tick(timeStep);
+        } else {
+            battle.tick(timeStep);
+            reference.tick(timeStep);
+        }
+        if (!same(battle, reference)) {
+            std::printf("SpaceBattle<t1 = %d>: %zu/%zu alive, expected %zu/%zu\n", t1,
+                        battle.countImperialFleet(), battle.countRebelFleet(),
+                        reference.countImperialFleet(), reference.countRebelFleet());
+            ++failures;
+            return;
+        }
+    }
+}
+
+void compareRuntime(std::mt19937 &rng, int minRebelAttack) {
+    auto random = [&rng](int lo, int hi) {
+        return std::uniform_int_distribution<int>(lo, hi)(rng);
+    };
+    const int t1 = 50;
+
+    RuntimeSpaceBattle<int> battle(0, t1);
+    battle.setObserver(nullptr);
+    std::vector<Ship> ships;
+    for (int i = random(0, 30); i > 0; --i) {
+        TIEFighter<int> ship(random(0, 400), random(0, 20));
+        battle.addShip(ship);
+        ships.push_back({ship.getShield(), ship.getAttackPower(), -1});
+    }
+    for (int i = random(0, 30); i > 0; --i) {
+        XWing<int> ship(random(0, 200), 300000, random(minRebelAttack, 20));
+        battle.addShip(ship);
+        ships.push_back({ship.getShield(), ship.getAttackPower(), 1});
+    }
+    for (int i = random(0, 30); i > 0; --i) {
+        Explorer<int> ship(random(0, 200), 300000);
+        battle.addShip(ship);
+        ships.push_back({ship.getShield(), 0, 0});
+    }
+    ReferenceBattle reference(ships, 0, t1);
+
+    int timeStep = random(1, 5);
+    for (int k = 0; k < 200; ++k) {
+        battle.tick(timeStep);
+        reference.tick(timeStep);
+        if (!same(battle, reference)) {
+            std::printf("RuntimeSpaceBattle: %zu/%zu alive, expected %zu/%zu\n",
+                        battle.countImperialFleet(), battle.countRebelFleet(),
+                        reference.countImperialFleet(), reference.countRebelFleet());
+            ++failures;
+            return;
+        }
+    }
+}
+
+struct Scenario {
+    SpaceBattle<int, 0, 100, XWing<int>, TIEFighter<int>, Explorer<int>, DeathStar<int>> battle;
+    int timeStep;
+    size_t maxTicks;
+};
+
+Scenario makeScenario(size_t, std::mt19937_64 &rng) {
+    auto random = [&rng](int lo, int hi) {
+        return std::uniform_int_distribution<int>(lo, hi)(rng);
+    };
+    Scenario scenario{{XWing<int>(random(1, 3000), 300000, random(-5, 20)),
+                       TIEFighter<int>(random(1, 3000), random(0, 20)),
+                       Explorer<int>(random(1, 3000), 300000),
+                       DeathStar<int>(random(1, 6000), random(0, 30))},
+                      random(-3, 7), static_cast<size_t>(random(1, 20000))};
+    scenario.battle.setObserver(nullptr);
+    return scenario;
+}
+
+bool same(const BattleResult &r1, const BattleResult &r2) {
+    return r1.status == r2.status && r1.ticks == r2.ticks &&
+           r1.imperialSurvivors == r2.imperialSurvivors && r1.rebelSurvivors == r2.rebelSurvivors;
+}
+
+void compareRunner(uint64_t seed, size_t threads) {
+    const size_t count = 3000;
+    BattleReport sequential = runBattles(makeScenario, count, seed, 1);
+    BattleReport parallel = runBattles(makeScenario, count, seed, threads);
+    for (size_t i = 0; i < count; ++i) {
+        if (!same(sequential.results[i], parallel.results[i])) {
+            std::printf("runBattles(seed = %llu, %zu threads): scenario %zu differs\n",
+                        static_cast<unsigned long long>(seed), threads, i);
+            ++failures;
+            return;
+        }
+    }
+    const BattleSummary &s1 = sequential.summary, &s2 = parallel.summary;
+    if (s1.battles != s2.battles || s1.unfinished != s2.unfinished || s1.draws != s2.draws ||
+        s1.imperiumWins != s2.imperiumWins || s1.rebellionWins != s2.rebellionWins ||
+        s1.totalTicks != s2.totalTicks) {
+        std::printf("runBattles(seed = %llu, %zu threads): summaries differ\n",
+                    static_cast<unsigned long long>(seed), threads);
+        ++failures;
+    }
+}
+
+}
+
+int main() {
+    std::mt19937 rng(2024);
+    for (int i = 0; i < 20000; ++i) {
+        int minRebelAttack = i % 2 == 0 ? 0 : -10;
+        compare<100>(rng, minRebelAttack);
+        compare<7>(rng, minRebelAttack);
+        if (i % 10 == 0)
+            compareRuntime(rng, minRebelAttack);
+        if (failures > 10)
+            break;
+    }
+    for (size_t threads : {2, 3, 8})
+        compareRunner(7 + threads, threads);
+    if (failures == 0)
+        std::puts("OK");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+#ifndef JNP_STAR_WARS_BATTLERUNNER_H
+#define JNP_STAR_WARS_BATTLERUNNER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "battle.h"
+
+struct BattleResult {
+    BattleStatus status;
+    size_t ticks;
+    size_t imperialSurvivors;
+    size_t rebelSurvivors;
+};
+
+struct BattleSummary {
+    size_t battles = 0;
+    size_t unfinished = 0;
+    size_t draws = 0;
+    size_t imperiumWins = 0;
+    size_t rebellionWins = 0;
+    size_t totalTicks = 0;
+
+    void add(const BattleResult &result) {
+        ++battles;
+        totalTicks += result.ticks;
+        switch (result.status) {
+            case BattleStatus::InProgress: ++unfinished; break;
+            case BattleStatus::Draw: ++draws; break;
+            case BattleStatus::ImperiumWon: ++imperiumWins; break;
+            case BattleStatus::RebellionWon: ++rebellionWins; break;
+        }
+    }
+
+    void add(const BattleSummary &summary) {
+        battles += summary.battles;
+        unfinished += summary.unfinished;
+        draws += summary.draws;
+        imperiumWins += summary.imperiumWins;
+        rebellionWins += summary.rebellionWins;
+        totalTicks += summary.totalTicks;
+    }
+};
+
+struct BattleReport {
+    // Result of the i-th scenario at index i.
+    std::vector<BattleResult> results;
+    BattleSummary summary;
+};
+
+namespace jnp_sw_ {
+    // SplitMix64 finalizer, used to derive independent per-scenario seeds.
+    constexpr uint64_t scenarioSeed(uint64_t seed, uint64_t index) {
+        uint64_t z = seed + (index + 1) * 0x9e3779b97f4a7c15ull;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    // Range of scenario indices [begin, end) owned by one worker, packed into
+    // a single atomic word. The owner takes indices from the front, idle
+    // workers steal the back half.
+    class WorkRange {
+        std::atomic<uint64_t> range{0};
+
+        static constexpr uint64_t pack(uint64_t begin, uint64_t end) {
+            return begin | (end << 32);
+        }
+
+    public:
+        void reset(uint64_t begin, uint64_t end) {
+            range.store(pack(begin, end));
+        }
+
+        bool pop(uint64_t &index) {
+            uint64_t r = range.load();
+            while (true) {
+                uint64_t begin = r & 0xffffffff, end = r >> 32;
+                if (begin >= end)
+                    return false;
+                if (range.compare_exchange_weak(r, pack(begin + 1, end))) {
+                    index = begin;
+                    return true;
+                }
+            }
+        }
+
+        bool steal(uint64_t &begin, uint64_t &end) {
+            uint64_t r = range.load();
+            while (true) {
+                uint64_t b = r & 0xffffffff, e = r >> 32;
+                if (b >= e)
+                    return false;
+                uint64_t half = (e - b + 1) / 2;
+                if (range.compare_exchange_weak(r, pack(b, e - half))) {
+                    begin = e - half;
+                    end = e;
+                    return true;
+                }
+            }
+        }
+    };
+}
+
+// Runs count battles on a work-stealing pool of threads workers (0 means
+// one per hardware thread) and returns their results with a summary.
+//
+// generator(index, rng) must return a scenario: an object with members
+// battle (a SpaceBattle), timeStep and maxTicks. Each scenario is created
+// and simulated by the worker that runs it, so workers share no battle
+// state. rng is seeded from seed and index only, so results do not depend
+// on scheduling: the same seed always gives the same report.
+template<typename Generator>
+BattleReport runBattles(Generator generator, size_t count, uint64_t seed, size_t threads = 0) {
+    assert(count <= 0xffffffff);
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::max<size_t>(1, std::min(threads, count));
+
+    BattleReport report;
+    report.results.resize(count);
+    std::vector<BattleSummary> summaries(threads);
+    std::vector<jnp_sw_::WorkRange> ranges(threads);
+    for (size_t w = 0; w < threads; ++w)
+        ranges[w].reset(count * w / threads, count * (w + 1) / threads);
+
+    auto runOne = [&](uint64_t index, BattleSummary &summary) {
+        std::mt19937_64 rng(jnp_sw_::scenarioSeed(seed, index));
+        auto scenario = generator(static_cast<size_t>(index), rng);
+
+        BattleResult result;
+        result.ticks = scenario.battle.advance(scenario.maxTicks, scenario.timeStep);
+        result.imperialSurvivors = scenario.battle.countImperialFleet();
+        result.rebelSurvivors = scenario.battle.countRebelFleet();
+        result.status = scenario.battle.status();
+
+        report.results[index] = result;
+        summary.add(result);
+    };
+
+    auto worker = [&](size_t w) {
+        uint64_t index, begin, end;
+        while (true) {
+            while (ranges[w].pop(index))
+                runOne(index, summaries[w]);
+
+            bool stolen = false;
+            for (size_t i = 1; i < threads && !stolen; ++i) {
+                if (ranges[(w + i) % threads].steal(begin, end)) {
+                    ranges[w].reset(begin, end);
+                    stolen = true;
+                }
+            }
+            if (!stolen)
+                return;
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t w = 1; w < threads; ++w)
+        pool.emplace_back(worker, w);
+    worker(0);
+    for (std::thread &t : pool)
+        t.join();
+
+    for (const BattleSummary &summary : summaries)
+        report.summary.add(summary);
+    return report;
+}
+
+#endif //JNP_STAR_WARS_BATTLERUNNER_H
@@ -0,0 +1,68 @@
+// Runs SpaceBattle<VALUE, 0, T1, ...> with SHIPS ships, alternately
+// TIEFighter and XWing with large shields, for TICKS ticks of length 1 and
+// prints the time per tick. With the default T1 only square times attack;
+// with T1=0 every tick is an attack phase over all (SHIPS / 2)^2 pairs.
+//
+// bench/run.sh builds it for several fleet sizes and value types and also
+// measures the compile time. From the battle/ directory:
+// g++ -std=c++17 -O2 -I. -DSHIPS=128 -DVALUE=int64_t bench/battle_bench.cc -o battle_bench
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <type_traits>
+#include <utility>
+
+#include "battle.h"
+
+#ifndef SHIPS
+#define SHIPS 32
+#endif
+
+#ifndef VALUE
+#define VALUE int
+#endif
+
+#ifndef T1
+#define T1 1000000
+#endif
+
+#ifndef TICKS
+#define TICKS 2000
+#endif
+
+#define STRINGIFY_(x) #x
+#define STRINGIFY(x) STRINGIFY_(x)
+
+using Value = VALUE;
+
+template<size_t i>
+using ShipAt = std::conditional_t<i % 2 == 0, TIEFighter<Value>, XWing<Value>>;
+
+template<size_t i>
+constexpr ShipAt<i> makeShip() {
+    if constexpr (i % 2 == 0)
+        return TIEFighter<Value>(1000000, 1);
+    else
+        return XWing<Value>(1000000, 300000, 1);
+}
+
+template<size_t... i>
+SpaceBattle<Value, 0, T1, ShipAt<i>...> makeBattle(std::index_sequence<i...>) {
+    return SpaceBattle<Value, 0, T1, ShipAt<i>...>(makeShip<i>()...);
+}
+
+int main() {
+    auto battle = makeBattle(std::make_index_sequence<SHIPS>());
+    battle.setObserver(nullptr);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < TICKS; ++i)
+        battle.tick(1);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+    std::printf("ships=%d value=%s ticks=%d ns/tick=%.1f total_ms=%.3f alive=%zu/%zu\n",
+                SHIPS, STRINGIFY(VALUE), TICKS, ns / TICKS, ns / 1e6,
+                battle.countImperialFleet(), battle.countRebelFleet());
+}
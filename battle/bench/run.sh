@@ -0,0 +1,55 @@
+#!/bin/sh
+# Builds and runs bench/battle_bench.cc for every fleet size in SIZES and
+# value type in VALUES, and prints the compile time, binary size, time per
+# tick and total simulation time of each instantiation.
+#
+# From the battle/ directory:
+#   bench/run.sh [battle-dir]
+#
+# battle-dir (default .) holds the battle.h under test, so an older version
+# can be measured against the current one, e.g.
+#   git worktree add /tmp/battle-old <rev>
+#   bench/run.sh /tmp/battle-old/battle
+#
+# Environment: CXX (g++), CXXFLAGS (-O2), SIZES (4 8 16 32 64 128 256 512),
+# VALUES (int int64_t double), T1, TICKS. double is expected to fail: a C++17
+# non-type template parameter cannot be a floating-point type.
+
+dir=${1:-.}
+cxx=${CXX:-g++}
+flags=${CXXFLAGS:--O2}
+sizes=${SIZES:-4 8 16 32 64 128 256 512}
+values=${VALUES:-int int64_t double}
+defines=
+[ -n "$T1" ] && defines="$defines -DT1=$T1"
+[ -n "$TICKS" ] && defines="$defines -DTICKS=$TICKS"
+
+out=$(mktemp -d) || exit 1
+trap 'rm -rf "$out"' EXIT
+
+now() {
+    date +%s.%N
+}
+
+printf '%6s %-8s %10s %10s %12s %12s %s\n' ships value compile_s binary_kb ns/tick total_ms alive
+for value in $values; do
+    for n in $sizes; do
+        start=$(now)
+        # shellcheck disable=SC2086
+        if ! $cxx -std=c++17 $flags -ftemplate-depth=2000 -I"$dir" -DSHIPS="$n" \
+                -DVALUE="$value" $defines bench/battle_bench.cc -o "$out/bench" 2>"$out/err"; then
+            printf '%6s %-8s does not compile: %s\n' "$n" "$value" \
+                "$(grep -m1 'error' "$out/err" | cut -c1-100)"
+            continue
+        fi
+        seconds=$(echo "$start $(now)" | awk '{ printf "%.2f", $2 - $1 }')
+        kb=$(( $(wc -c <"$out/bench") / 1024 ))
+        "$out/bench" | awk -v n="$n" -v value="$value" -v s="$seconds" -v kb="$kb" '{
+            for (i = 1; i <= NF; ++i) {
+                split($i, kv, "=")
+                f[kv[1]] = kv[2]
+            }
+            printf "%6s %-8s %10s %10s %12s %12s %s\n", n, value, s, kb, f["ns/tick"], f["total_ms"], f["alive"]
+        }'
+    done
+done
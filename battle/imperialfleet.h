@@ -12,18 +12,18 @@ class ImperialStarship {
 public:
     using valueType = U;
 
-    ImperialStarship(U shield, U attackPower)
+    constexpr ImperialStarship(U shield, U attackPower)
             : shield(shield), attackPower(attackPower) {}
 
-    U getShield() const {
+    constexpr U getShield() const {
         return shield;
     }
 
-    U getAttackPower() const {
+    constexpr U getAttackPower() const {
         return attackPower;
     }
 
-    void takeDamage(U damage) {
+    constexpr void takeDamage(U damage) {
         shield = shield > damage ? shield - damage : 0;
     }
 };
@@ -46,7 +46,7 @@ namespace jnp_sw_ {
 }
 
 template<typename I, typename R>
-void attack(I& imperialShip, R& rebelShip) {
+constexpr void attack(I& imperialShip, R& rebelShip) {
     static_assert(jnp_sw_::IsImperial<I>() && jnp_sw_::IsRebel<R>(),
                   "Invalid ship types for battle");
 
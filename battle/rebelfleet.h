@@ -14,31 +14,31 @@ public:
     using valueType = U;
 
     template<bool enabled = armed, typename = typename std::enable_if_t<enabled, int>>
-    RebelStarship(U shield, U speed, U attackPower)
+    constexpr RebelStarship(U shield, U speed, U attackPower)
             : shield(shield), speed(speed), attackPower(attackPower) {
         assert(static_cast<U>(minSpeed) <= speed && speed <= static_cast<U>(maxSpeed));
     }
 
     template<bool enabled = !armed, typename = typename std::enable_if_t<enabled, int>>
-    RebelStarship(U shield, U speed)
+    constexpr RebelStarship(U shield, U speed)
             : shield(shield), speed(speed), attackPower(0) {
         assert(static_cast<U>(minSpeed) <= speed && speed <= static_cast<U>(maxSpeed));
     }
 
-    U getShield() const {
+    constexpr U getShield() const {
         return shield;
     }
 
-    U getSpeed() const {
+    constexpr U getSpeed() const {
         return speed;
     }
 
     template<bool enabled = armed, typename = typename std::enable_if_t<enabled, int>>
-    U getAttackPower() const {
+    constexpr U getAttackPower() const {
         return attackPower;
     }
 
-    void takeDamage(U damage) {
+    constexpr void takeDamage(U damage) {
         shield = shield > damage ? shield - damage : 0;
     }
 };
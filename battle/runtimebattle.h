@@ -0,0 +1,161 @@
+#ifndef JNP_STAR_WARS_RUNTIMEBATTLE_H
+#define JNP_STAR_WARS_RUNTIMEBATTLE_H
+
+#include <algorithm>
+#include <cassert>
+#include <type_traits>
+#include <vector>
+
+#include "battle.h"
+#include "damagekernel.h"
+#include "rebelfleet.h"
+#include "imperialfleet.h"
+
+// Counterpart of SpaceBattle for fleets whose composition is known only at
+// runtime. Ship statistics are kept in contiguous per-class arrays, so that
+// the attack phase is a set of kernel calls over them (see damagekernel.h).
+// Damage is applied as in attack(): every alive imperial ship attacks every
+// alive rebel ship, in the order the ships were added, and armed rebels
+// return fire.
+template<typename T>
+class RuntimeSpaceBattle {
+    static_assert(std::is_integral<T>::value, "RuntimeSpaceBattle: T must be integral");
+
+    std::vector<T> imperialShields;
+    std::vector<T> imperialAttacks;
+
+    std::vector<T> armedShields;
+    std::vector<T> armedSpeeds;
+    std::vector<T> armedAttacks;
+    bool nonNegativeArmedAttacks = true;
+
+    std::vector<T> unarmedShields;
+    std::vector<T> unarmedSpeeds;
+
+    std::vector<T> squares;
+    T t1;
+    T time;
+
+    size_t imperialAlive = 0;
+    size_t rebelAlive = 0;
+
+public:
+    using Observer = void (*)(BattleStatus);
+
+private:
+    Observer observer = printBattleStatus;
+
+    // As in SpaceBattle, an imperial ship's state is compared only before and
+    // after its whole row of fights, since return fire may revive it.
+    void attackAll() {
+        for (size_t i = 0; i < imperialShields.size(); ++i) {
+            if (imperialShields[i] > 0) {
+                T damage = imperialAttacks[i];
+                size_t destroyed = jnp_sw_::damageRebels(unarmedShields.data(),
+                                                         unarmedShields.size(), damage);
+                imperialShields[i] = jnp_sw_::damageArmedRebels(
+                        armedShields.data(), armedAttacks.data(), armedShields.size(),
+                        damage, imperialShields[i], nonNegativeArmedAttacks, destroyed);
+                rebelAlive -= destroyed;
+                imperialAlive -= !(imperialShields[i] > 0);
+            }
+        }
+    }
+
+public:
+    RuntimeSpaceBattle(T t0, T t1) : t1(t1), time(t0) {
+        assert(0 <= t0 && t0 <= t1);
+        for (T i = 0; i == 0 || i <= t1 / i; ++i)
+            squares.push_back(i * i);
+    }
+
+    void addShip(const ImperialStarship<T> &ship) {
+        imperialShields.push_back(ship.getShield());
+        imperialAttacks.push_back(ship.getAttackPower());
+        imperialAlive += ship.getShield() > 0;
+    }
+
+    template<int minSpeed, int maxSpeed>
+    void addShip(const RebelStarship<T, true, minSpeed, maxSpeed> &ship) {
+        armedShields.push_back(ship.getShield());
+        armedSpeeds.push_back(ship.getSpeed());
+        armedAttacks.push_back(ship.getAttackPower());
+        rebelAlive += ship.getShield() > 0;
+        nonNegativeArmedAttacks = nonNegativeArmedAttacks && ship.getAttackPower() >= 0;
+    }
+
+    template<int minSpeed, int maxSpeed>
+    void addShip(const RebelStarship<T, false, minSpeed, maxSpeed> &ship) {
+        unarmedShields.push_back(ship.getShield());
+        unarmedSpeeds.push_back(ship.getSpeed());
+        rebelAlive += ship.getShield() > 0;
+    }
+
+    void reserve(size_t imperial, size_t armedRebel, size_t unarmedRebel) {
+        imperialShields.reserve(imperial);
+        imperialAttacks.reserve(imperial);
+        armedShields.reserve(armedRebel);
+        armedSpeeds.reserve(armedRebel);
+        armedAttacks.reserve(armedRebel);
+        unarmedShields.reserve(unarmedRebel);
+        unarmedSpeeds.reserve(unarmedRebel);
+    }
+
+    const std::vector<T> &getImperialShields() const {
+        return imperialShields;
+    }
+
+    const std::vector<T> &getArmedRebelShields() const {
+        return armedShields;
+    }
+
+    const std::vector<T> &getUnarmedRebelShields() const {
+        return unarmedShields;
+    }
+
+    size_t countRebelFleet() const {
+        return rebelAlive;
+    }
+
+    size_t countImperialFleet() const {
+        return imperialAlive;
+    }
+
+    BattleStatus status() const {
+        if (rebelAlive == 0 && imperialAlive == 0)
+            return BattleStatus::Draw;
+        else if (rebelAlive == 0)
+            return BattleStatus::ImperiumWon;
+        else if (imperialAlive == 0)
+            return BattleStatus::RebellionWon;
+        return BattleStatus::InProgress;
+    }
+
+    bool isFinished() const {
+        return status() != BattleStatus::InProgress;
+    }
+
+    // As in SpaceBattle: by default the outcome is printed, nullptr disables
+    // all output.
+    void setObserver(Observer o) {
+        observer = o;
+    }
+
+    BattleStatus tick(T timeStep) {
+        BattleStatus current = status();
+        if (current != BattleStatus::InProgress) {
+            if (observer != nullptr)
+                observer(current);
+            return current;
+        }
+
+        if (std::binary_search(squares.begin(), squares.end(), time))
+            attackAll();
+
+        time += timeStep;
+        time %= (t1 + 1);
+        return status();
+    }
+};
+
+#endif //JNP_STAR_WARS_RUNTIMEBATTLE_H
@@ -1,11 +1,75 @@
 #include "battle.h"
+#include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <limits>
 
-bool BasicTimer::attackTime() const {
+namespace {
+
+const Time attackPeriod = 30;
+
+bool isAttackTime(long long time) {
     return (time % 5 != 0) && (time % 2 == 0 || time % 3 == 0);
 }
 
+}
+
+size_t Timer::nextAttackAfter(Time) const {
+    return attackTime() ? 0 : 1;
+}
+
+void Timer::advance(Time delta, size_t ticks) {
+    for (size_t i = 0; i < ticks; ++i) {
+        tick(delta);
+    }
+}
+
+bool BasicTimer::attackTime() const {
+    return isAttackTime(time);
+}
+
+size_t BasicTimer::nextAttackAfter(Time delta) const {
+    if (attackTime()) {
+        return 0;
+    }
+    if (delta <= 0) {
+        return delta == 0 ? std::numeric_limits<size_t>::max() : 1;
+    }
+
+    size_t lap = static_cast<size_t>((maxTime - time) / delta) + 1;
+    size_t steps = std::min<size_t>(lap, attackPeriod);
+    for (size_t k = 1; k < steps; ++k) {
+        if (isAttackTime(time + static_cast<long long>(k) * delta)) {
+            return k;
+        }
+    }
+    return lap;
+}
+
+void BasicTimer::advance(Time delta, size_t ticks) {
+    if (delta < 0) {
+        Timer::advance(delta, ticks);
+        return;
+    }
+    long long current = time;
+    if (current < 0) {
+        // tick() leaves a negative time negative, without wrapping, until
+        // it becomes non-negative.
+        if (delta == 0) {
+            return;
+        }
+        size_t toNonNegative = static_cast<size_t>((delta - 1 - current) / delta);
+        if (ticks < toNonNegative) {
+            time = static_cast<Time>(current + static_cast<long long>(ticks) * delta);
+            return;
+        }
+        current = (current + static_cast<long long>(toNonNegative) * delta) % (maxTime + 1LL);
+        ticks -= toNonNegative;
+    }
+    unsigned long long period = static_cast<unsigned long long>(maxTime) + 1;
+    time = static_cast<Time>((current + ticks % period * (delta % period)) % period);
+}
+
 void BasicTimer::tick(Time delta) {
     time += delta;
     time %= maxTime + 1;
@@ -18,52 +82,156 @@ void BasicTimer::init(Time t0, Time t1) {
     maxTime = t1;
 }
 
+namespace {
+
+template<typename Unit>
+size_t compactUnits(std::vector<std::shared_ptr<Unit>> &units, std::vector<UnitId> &ids) {
+    size_t alive = 0;
+    size_t size = 0;
+    for (size_t i = 0; i < units.size(); ++i) {
+        size_t unitAlive = units[i]->getAlive();
+        if (unitAlive > 0) {
+            alive += unitAlive;
+            units[size] = std::move(units[i]);
+            ids[size++] = ids[i];
+        }
+    }
+    units.resize(size);
+    ids.resize(size);
+    return alive;
+}
+
+template<typename Unit>
+std::vector<UnitId> buildOrder(const std::vector<std::shared_ptr<Unit>> &units) {
+    std::vector<UnitId> ids(units.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        ids[i] = static_cast<UnitId>(i);
+    }
+    return ids;
+}
+
+}
+
 SpaceBattle::SpaceBattle(
     std::vector<std::shared_ptr<RebelUnit>> &&rebels,
     std::vector<std::shared_ptr<ImperialUnit>> &&imperials,
-    std::unique_ptr<Timer> timer) :
+    std::unique_ptr<Timer> timer,
+    std::unique_ptr<FlatFleet> flat) :
 
     rebels(std::move(rebels)),
     imperials(std::move(imperials)),
-    timer(std::move(timer)) {}
+    timer(std::move(timer)),
+    flat(std::move(flat)),
+    rebelIds(buildOrder(this->rebels)),
+    imperialIds(buildOrder(this->imperials)) {
+
+    compact();
+}
 
 size_t
 SpaceBattle::countImperialFleet() const {
-    size_t ans = 0;
-    for (const auto &unit : imperials) {
-        ans += unit->getAlive();
-    }
-    return ans;
+    return imperialAlive;
 }
 
 size_t
 SpaceBattle::countRebelFleet() const {
-    size_t ans = 0;
-    for (const auto &unit : rebels) {
-        ans += unit->getAlive();
+    return rebelAlive;
+}
+
+void
+SpaceBattle::compact() {
+    imperialAlive = compactUnits(imperials, imperialIds);
+    rebelAlive = compactUnits(rebels, rebelIds);
+}
+
+void
+SpaceBattle::fightObserved(size_t imperial, size_t rebel) {
+    ImperialUnit &imp = *imperials[imperial];
+    RebelUnit &reb = *rebels[rebel];
+    auto weapon = dynamic_cast<const Weapon *>(&reb);
+    size_t impAlive = imp.getAlive();
+    size_t rebAlive = reb.getAlive();
+    FightEvent event{ticks, imperialIds[imperial], rebelIds[rebel], imp.getAttackPower(),
+                     weapon != nullptr ? weapon->getAttackPower() : 0, 0, 0};
+    reb.fight(imp);
+    event.imperialLosses = static_cast<uint32_t>(impAlive - imp.getAlive());
+    event.rebelLosses = static_cast<uint32_t>(rebAlive - reb.getAlive());
+    observer->onFight(event);
+}
+
+size_t
+SpaceBattle::fight() {
+    size_t fights = 0;
+    if (flat != nullptr) {
+        fights = flat->fight(observer, ticks);
+    } else {
+        for (size_t k = 0; k < imperials.size(); ++k) {
+            auto &imp = imperials[k];
+            size_t impAlive = imp->getAlive();
+            for (size_t i = 0; i < rebels.size() && impAlive > 0; ++i) {
+                if (rebels[i]->getAlive() > 0) {
+                    if (observer != nullptr) {
+                        fightObserved(k, i);
+                    } else {
+                        rebels[i]->fight(*imp);
+                    }
+                    impAlive = imp->getAlive();
+                    ++fights;
+                }
+            }
+        }
     }
-    return ans;
+    compact();
+    return fights;
 }
 
 void
 SpaceBattle::tick(Time timeStep) {
-    size_t impCount = countImperialFleet();
-    size_t rebCount = countRebelFleet();
-    if (impCount == 0 && rebCount == 0) {
+    size_t fights = 0;
+    bool attackPhase = false;
+    if (imperialAlive == 0 && rebelAlive == 0) {
         std::cout << "DRAW\n";
-    } else if (impCount == 0) {
+    } else if (imperialAlive == 0) {
         std::cout << "REBELLION WON\n";
-    } else if (rebCount == 0) {
+    } else if (rebelAlive == 0) {
         std::cout << "IMPERIUM WON\n";
     } else if (timer->attackTime()) {
-        for (auto &imp : imperials) {
-            for (auto &reb : rebels) { if (reb->getAlive() > 0 && imp->getAlive() > 0) {
-                    reb->fight(*imp);
-                }
-            }
-        }
+        attackPhase = true;
+        fights = fight();
     }
     timer->tick(timeStep);
+    if (observer != nullptr) {
+        observer->onTick(TickSummary{ticks, imperialAlive, rebelAlive,
+                                     static_cast<uint32_t>(fights), attackPhase});
+    }
+    ++ticks;
+}
+
+void
+SpaceBattle::setObserver(BattleObserver *observer) {
+    this->observer = observer;
+}
+
+size_t
+SpaceBattle::run(Time timeStep, size_t maxTicks) {
+    size_t done = 0;
+    while (done < maxTicks) {
+        if (imperialAlive == 0 || rebelAlive == 0) {
+            tick(timeStep);
+            return done + 1;
+        }
+        size_t idle = timer->nextAttackAfter(timeStep);
+        if (idle == 0) {
+            tick(timeStep);
+            ++done;
+        } else {
+            idle = std::min(idle, maxTicks - done);
+            timer->advance(timeStep, idle);
+            ticks += idle;
+            done += idle;
+        }
+    }
+    return done;
 }
 
 SpaceBattle::Builder&
@@ -96,11 +264,24 @@ SpaceBattle::Builder::timer(std::unique_ptr<Timer> &&timer) {
     return *this;
 }
 
+SpaceBattle::Builder&
+SpaceBattle::Builder::dataOriented(bool enabled) {
+    flat = enabled;
+    return *this;
+}
+
+SpaceBattle::Builder&
+SpaceBattle::Builder::threads(size_t count) {
+    workers = count;
+    return *this;
+}
+
 SpaceBattle
 SpaceBattle::Builder::build() {
     if (clock == nullptr) {
         clock = std::make_unique<BasicTimer>();
     }
     clock->init(t0, t1);
-    return SpaceBattle(std::move(rebels), std::move(imperials), std::move(clock));
+    std::unique_ptr<FlatFleet> fleet = flat ? FlatFleet::create(rebels, imperials, workers) : nullptr;
+    return SpaceBattle(std::move(rebels), std::move(imperials), std::move(clock), std::move(fleet));
 }
@@ -1,6 +1,8 @@
 #ifndef BATTLE_H
 #define BATTLE_H
 
+#include "battlelog.h"
+#include "flatbattle.h"
 #include "imperialfleet.h"
 #include "rebelfleet.h"
 
@@ -12,6 +14,8 @@ public:
     virtual void init(Time t0, Time t1) = 0;
     virtual void tick(Time delta) = 0;
     virtual bool attackTime() const = 0;
+    virtual size_t nextAttackAfter(Time delta) const;
+    virtual void advance(Time delta, size_t ticks);
 };
 
 class BasicTimer : public Timer {
@@ -19,6 +23,8 @@ public:
     void init(Time t0, Time t1) override;
     void tick(Time delta) override;
     bool attackTime() const override; 
+    size_t nextAttackAfter(Time delta) const override;
+    void advance(Time delta, size_t ticks) override;
 private:
     Time time;
     Time maxTime;
@@ -29,6 +35,8 @@ public:
     size_t countImperialFleet() const;
     size_t countRebelFleet() const;
     void tick(Time timeStep);
+    size_t run(Time timeStep, size_t maxTicks);
+    void setObserver(BattleObserver *observer);
 
     friend class Builder;
     class Builder {
@@ -38,6 +46,12 @@ public:
         Builder& startTime(Time t);
         Builder& maxTime(Time t);
         Builder& timer(std::unique_ptr<Timer> &&timer);
+        Builder& dataOriented(bool enabled);
+        // Threads for the attack phase of the data-oriented engine only. It
+        // is ignored by the polymorphic engine, which is used without
+        // dataOriented(true) or when a unit is not one of the library's
+        // ship types (see FlatFleet::create).
+        Builder& threads(size_t count);
         SpaceBattle build();
     private:
         std::vector<std::shared_ptr<RebelUnit>> rebels;
@@ -45,16 +59,29 @@ public:
         std::unique_ptr<Timer> clock;
         Time t0 = 0;
         Time t1 = 0;
+        bool flat = false;
+        size_t workers = 1;
     };
 
 private:
     SpaceBattle(
         std::vector<std::shared_ptr<RebelUnit>> &&rebels,
         std::vector<std::shared_ptr<ImperialUnit>> &&imperials,
-        std::unique_ptr<Timer> timer);
+        std::unique_ptr<Timer> timer,
+        std::unique_ptr<FlatFleet> flat);
+    size_t fight();
+    void fightObserved(size_t imperial, size_t rebel);
+    void compact();
     std::vector<std::shared_ptr<RebelUnit>> rebels;
     std::vector<std::shared_ptr<ImperialUnit>> imperials;
     std::unique_ptr<Timer> timer;
+    std::unique_ptr<FlatFleet> flat;
+    size_t imperialAlive = 0;
+    size_t rebelAlive = 0;
+    std::vector<UnitId> rebelIds;
+    std::vector<UnitId> imperialIds;
+    BattleObserver *observer = nullptr;
+    uint64_t ticks = 0;
 };
 
 #endif // BATTLE_H
@@ -0,0 +1,65 @@
+#include "battlelog.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+
+static_assert(sizeof(FightEvent) == 32 && sizeof(TickSummary) == 32,
+              "Unexpected padding in battle events");
+
+BattleRecorder::BattleRecorder(size_t capacity) : records(capacity) {
+    assert(capacity > 0);
+}
+
+void BattleRecorder::push(const Record &record) {
+    records[total % records.size()] = record;
+    ++total;
+}
+
+void BattleRecorder::onFight(const FightEvent &event) {
+    Record record;
+    record.kind = Record::Fight;
+    record.reserved = 0;
+    record.fight = event;
+    push(record);
+}
+
+void BattleRecorder::onTick(const TickSummary &summary) {
+    Record record;
+    record.kind = Record::Tick;
+    record.reserved = 0;
+    record.tick = summary;
+    push(record);
+}
+
+size_t BattleRecorder::size() const {
+    return total < records.size() ? static_cast<size_t>(total) : records.size();
+}
+
+uint64_t BattleRecorder::dropped() const {
+    return total - size();
+}
+
+void BattleRecorder::clear() {
+    total = 0;
+}
+
+bool BattleRecorder::dump(const std::string &path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    char header[32] = {'B', 'T', 'L', 'L', 'O', 'G', '\0', '\1'};
+    uint64_t recordSize = sizeof(Record);
+    uint64_t count = size();
+    uint64_t lost = dropped();
+    std::memcpy(header + 8, &recordSize, 8);
+    std::memcpy(header + 16, &count, 8);
+    std::memcpy(header + 24, &lost, 8);
+    out.write(header, sizeof(header));
+
+    size_t first = static_cast<size_t>(lost % records.size());
+    size_t tail = std::min(static_cast<size_t>(count), records.size() - first);
+    out.write(reinterpret_cast<const char *>(records.data() + first),
+              static_cast<std::streamsize>(tail * sizeof(Record)));
+    out.write(reinterpret_cast<const char *>(records.data()),
+              static_cast<std::streamsize>((count - tail) * sizeof(Record)));
+    return out.good();
+}
@@ -0,0 +1,80 @@
+#ifndef BATTLELOG_H
+#define BATTLELOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "imperialfleet.h"
+
+// Units are identified by their position among the imperial or rebel units
+// passed to SpaceBattle::Builder, in order of addition.
+using UnitId = uint32_t;
+
+// One fight between an imperial unit and a rebel unit. The attacks are the
+// values used in the fight (rebelAttack is 0 for unarmed rebels), losses are
+// the numbers of ships destroyed on each side.
+struct FightEvent {
+    uint64_t tick;
+    UnitId imperial;
+    UnitId rebel;
+    AttackPower imperialAttack;
+    AttackPower rebelAttack;
+    uint32_t imperialLosses;
+    uint32_t rebelLosses;
+};
+
+// State after a call to SpaceBattle::tick. Ticks skipped by SpaceBattle::run
+// have no attack phase and produce no summary.
+struct TickSummary {
+    uint64_t tick;
+    uint64_t imperialAlive;
+    uint64_t rebelAlive;
+    uint32_t fights;
+    uint32_t attackPhase;
+};
+
+class BattleObserver {
+public:
+    virtual ~BattleObserver() = default;
+    virtual void onFight(const FightEvent &event) = 0;
+    virtual void onTick(const TickSummary &summary) = 0;
+};
+
+// Keeps the last capacity events in a ring buffer of fixed-size records.
+// dump() writes a 32-byte header ("BTLLOG\0\1", record size, record count,
+// number of overwritten records) followed by the records from the oldest,
+// all in the host's byte order.
+class BattleRecorder : public BattleObserver {
+public:
+    struct Record {
+        enum Kind : uint32_t {
+            Fight = 1,
+            Tick = 2
+        };
+
+        uint32_t kind;
+        uint32_t reserved;
+        union {
+            FightEvent fight;
+            TickSummary tick;
+        };
+    };
+
+    explicit BattleRecorder(size_t capacity);
+    void onFight(const FightEvent &event) override;
+    void onTick(const TickSummary &summary) override;
+    size_t size() const;
+    uint64_t dropped() const;
+    void clear();
+    bool dump(const std::string &path) const;
+
+private:
+    void push(const Record &record);
+
+    std::vector<Record> records;
+    uint64_t total = 0;
+};
+
+#endif // BATTLELOG_H
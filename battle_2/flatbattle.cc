@@ -0,0 +1,324 @@
+#include "flatbattle.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <typeinfo>
+#include <unordered_map>
+
+namespace {
+
+const size_t minParallelPairs = 1 << 16;
+
+struct alignas(64) Progress {
+    std::atomic<size_t> done{0};
+};
+
+ShieldPoints damaged(ShieldPoints shield, AttackPower damage) {
+    return shield > damage ? shield - damage : 0;
+}
+
+template<typename T>
+size_t columnIndex(std::unordered_map<const void *, size_t> &index, T *ship,
+                   std::vector<T *> &ships) {
+    auto it = index.find(ship);
+    if (it != index.end()) {
+        return it->second;
+    }
+    index.emplace(ship, ships.size());
+    ships.push_back(ship);
+    return ships.size() - 1;
+}
+
+}
+
+std::unique_ptr<FlatFleet>
+FlatFleet::create(
+    const std::vector<std::shared_ptr<RebelUnit>> &rebels,
+    const std::vector<std::shared_ptr<ImperialUnit>> &imperials,
+    size_t threads) {
+
+    std::unique_ptr<FlatFleet> fleet(new FlatFleet());
+    fleet->threads = std::max<size_t>(threads, 1);
+    for (const auto &unit : imperials) {
+        fleet->unitBegin.push_back(fleet->handles.size());
+        if (!fleet->addImperial(unit.get())) {
+            return nullptr;
+        }
+    }
+    fleet->unitBegin.push_back(fleet->handles.size());
+    for (size_t u = 0; u < imperials.size(); ++u) {
+        fleet->units.push_back(u);
+    }
+
+    for (const auto &unit : rebels) {
+        if (!fleet->addRebel(unit.get())) {
+            return nullptr;
+        }
+    }
+
+    std::unordered_map<const void *, size_t> index;
+    std::vector<ImperialStarship *> leaves;
+    for (auto &handle : fleet->handles) {
+        handle.leaf = columnIndex(index, fleet->leafShips[handle.leaf], leaves);
+    }
+    fleet->leafShips = std::move(leaves);
+    fleet->mergeHandles();
+    std::vector<char> owned(fleet->leafShips.size(), 0);
+    for (const auto &handle : fleet->handles) {
+        fleet->disjoint = fleet->disjoint && !owned[handle.leaf];
+        owned[handle.leaf] = 1;
+    }
+    fleet->leafShields.resize(fleet->leafShips.size());
+    fleet->leafStored.resize(fleet->leafShips.size());
+    fleet->leafPowers.resize(fleet->leafShips.size());
+    for (size_t i = 0; i < fleet->leafShips.size(); ++i) {
+        fleet->leafPowers[i] = fleet->leafShips[i]->BasicWeapon::getAttackPower();
+    }
+
+    index.clear();
+    std::vector<RebelStarship *> unique;
+    for (auto &r : fleet->rebelOrder) {
+        r = columnIndex(index, fleet->rebelShips[r], unique);
+    }
+    fleet->disjoint = fleet->disjoint && unique.size() == fleet->rebelOrder.size();
+    fleet->rebelShips = std::move(unique);
+    fleet->rebelShields.resize(fleet->rebelShips.size());
+    fleet->rebelStored.resize(fleet->rebelShips.size());
+    fleet->rebelPowers.assign(fleet->rebelShips.size(), 0);
+    fleet->rebelArmed.assign(fleet->rebelShips.size(), 0);
+    for (size_t i = 0; i < fleet->rebelShips.size(); ++i) {
+        auto armed = dynamic_cast<ArmedRebelStarship *>(fleet->rebelShips[i]);
+        if (armed != nullptr) {
+            fleet->rebelPowers[i] = armed->BasicWeapon::getAttackPower();
+            fleet->rebelArmed[i] = 1;
+        }
+    }
+
+    for (size_t i = 0; i < fleet->leafShips.size(); ++i) {
+        fleet->liveLeaves.push_back(i);
+    }
+    for (size_t i = 0; i < fleet->rebelShips.size(); ++i) {
+        fleet->liveRebels.push_back(i);
+    }
+    fleet->load();
+    fleet->compact();
+    return fleet;
+}
+
+bool
+FlatFleet::addImperial(ImperialUnit *unit) {
+    const std::type_info &type = typeid(*unit);
+    if (type == typeid(Squadron)) {
+        for (const auto &ship : static_cast<Squadron *>(unit)->ships) {
+            if (!addImperial(ship.get())) {
+                return false;
+            }
+        }
+        return true;
+    }
+    if (type != typeid(ImperialStarship) && type != typeid(DeathStar) &&
+        type != typeid(ImperialDestroyer) && type != typeid(TIEFighter)) {
+        return false;
+    }
+
+    handles.push_back(LeafHandle{leafShips.size(), 1});
+    leafShips.push_back(dynamic_cast<ImperialStarship *>(unit));
+    return true;
+}
+
+void
+FlatFleet::mergeHandles() {
+    size_t size = 0;
+    for (size_t u = 0; u + 1 < unitBegin.size(); ++u) {
+        auto first = handles.begin() + unitBegin[u];
+        auto last = handles.begin() + unitBegin[u + 1];
+        std::sort(first, last, [](const LeafHandle &a, const LeafHandle &b) {
+            return a.leaf < b.leaf;
+        });
+        unitBegin[u] = size;
+        for (auto it = first; it != last; ++it) {
+            if (size > unitBegin[u] && handles[size - 1].leaf == it->leaf) {
+                handles[size - 1].count += it->count;
+            } else {
+                handles[size++] = *it;
+            }
+        }
+    }
+    unitBegin.back() = size;
+    handles.resize(size);
+}
+
+bool
+FlatFleet::addRebel(RebelUnit *unit) {
+    const std::type_info &type = typeid(*unit);
+    if (type != typeid(RebelStarship) && type != typeid(Explorer) &&
+        type != typeid(ArmedRebelStarship) && type != typeid(XWing) &&
+        type != typeid(StarCruiser)) {
+        return false;
+    }
+    rebelOrder.push_back(rebelShips.size());
+    rebelIds.push_back(static_cast<UnitId>(rebelIds.size()));
+    rebelShips.push_back(dynamic_cast<RebelStarship *>(unit));
+    return true;
+}
+
+void
+FlatFleet::load() {
+    for (size_t i : liveLeaves) {
+        leafShields[i] = leafStored[i] = leafShips[i]->BasicShield::getShield();
+    }
+    for (size_t i : liveRebels) {
+        rebelShields[i] = rebelStored[i] = rebelShips[i]->BasicShield::getShield();
+    }
+}
+
+void
+FlatFleet::store() {
+    for (size_t i : liveLeaves) {
+        if (leafShields[i] != leafStored[i]) {
+            leafShips[i]->ImperialStarship::takeDamage(leafStored[i] - leafShields[i]);
+        }
+    }
+    for (size_t i : liveRebels) {
+        if (rebelShields[i] != rebelStored[i]) {
+            rebelShips[i]->BasicShield::takeDamage(rebelStored[i] - rebelShields[i]);
+        }
+    }
+}
+
+void
+FlatFleet::damageUnit(size_t unit, AttackPower damage) {
+    for (size_t h = unitBegin[unit]; h < unitBegin[unit + 1]; ++h) {
+        ShieldPoints &shield = leafShields[handles[h].leaf];
+        for (size_t k = 0; k < handles[h].count; ++k) {
+            shield = damaged(shield, damage);
+        }
+    }
+}
+
+void
+FlatFleet::aggregate(size_t unit, size_t &alive, AttackPower &power) const {
+    alive = 0;
+    power = 0;
+    for (size_t h = unitBegin[unit]; h < unitBegin[unit + 1]; ++h) {
+        if (leafShields[handles[h].leaf] > 0) {
+            alive += handles[h].count;
+            power += static_cast<AttackPower>(handles[h].count) * leafPowers[handles[h].leaf];
+        }
+    }
+}
+
+void
+FlatFleet::compact() {
+    size_t size = 0;
+    for (size_t u : units) {
+        size_t alive;
+        AttackPower power;
+        aggregate(u, alive, power);
+        if (alive > 0) {
+            units[size++] = u;
+        }
+    }
+    units.resize(size);
+
+    size = 0;
+    for (size_t i = 0; i < rebelOrder.size(); ++i) {
+        if (rebelShields[rebelOrder[i]] > 0) {
+            rebelOrder[size] = rebelOrder[i];
+            rebelIds[size++] = rebelIds[i];
+        }
+    }
+    rebelOrder.resize(size);
+    rebelIds.resize(size);
+
+    auto dead = [](const std::vector<ShieldPoints> &shields) {
+        return [&shields](size_t i) { return shields[i] == 0; };
+    };
+    liveLeaves.erase(std::remove_if(liveLeaves.begin(), liveLeaves.end(), dead(leafShields)),
+                     liveLeaves.end());
+    liveRebels.erase(std::remove_if(liveRebels.begin(), liveRebels.end(), dead(rebelShields)),
+                     liveRebels.end());
+}
+
+size_t
+FlatFleet::fightBlock(size_t unit, size_t begin, size_t end,
+                      BattleObserver *observer, uint64_t tick) {
+    size_t fights = 0;
+    size_t alive;
+    AttackPower power;
+    aggregate(unit, alive, power);
+    for (size_t i = begin; i < end && alive > 0; ++i) {
+        size_t r = rebelOrder[i];
+        if (rebelShields[r] > 0) {
+            ++fights;
+            size_t aliveBefore = alive;
+            AttackPower powerBefore = power;
+            rebelShields[r] = damaged(rebelShields[r], power);
+            if (rebelArmed[r]) {
+                damageUnit(unit, rebelPowers[r]);
+                aggregate(unit, alive, power);
+            }
+            if (observer != nullptr) {
+                observer->onFight(FightEvent{tick, static_cast<UnitId>(unit), rebelIds[i],
+                                             powerBefore, rebelPowers[r],
+                                             static_cast<uint32_t>(aliveBefore - alive),
+                                             rebelShields[r] == 0});
+            }
+        }
+    }
+    return fights;
+}
+
+size_t
+FlatFleet::fightParallel(size_t workers) {
+    std::vector<Progress> progress(workers);
+    std::vector<size_t> fights(workers, 0);
+    auto worker = [&](size_t t) {
+        size_t begin = rebelOrder.size() * t / workers;
+        size_t end = rebelOrder.size() * (t + 1) / workers;
+        size_t count = 0;
+        for (size_t k = 0; k < units.size(); ++k) {
+            if (t > 0) {
+                while (progress[t - 1].done.load(std::memory_order_acquire) <= k) {
+                    std::this_thread::yield();
+                }
+            }
+            count += fightBlock(units[k], begin, end, nullptr, 0);
+            progress[t].done.store(k + 1, std::memory_order_release);
+        }
+        fights[t] = count;
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < workers; ++t) {
+        pool.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto &thread : pool) {
+        thread.join();
+    }
+
+    size_t total = 0;
+    for (size_t count : fights) {
+        total += count;
+    }
+    return total;
+}
+
+size_t
+FlatFleet::fight(BattleObserver *observer, uint64_t tick) {
+    load();
+    size_t fights = 0;
+    size_t workers = std::min(threads, rebelOrder.size());
+    if (observer == nullptr && workers > 1 && disjoint &&
+        units.size() * rebelOrder.size() >= minParallelPairs) {
+        fights = fightParallel(workers);
+    } else {
+        for (size_t u : units) {
+            fights += fightBlock(u, 0, rebelOrder.size(), observer, tick);
+        }
+    }
+    store();
+    compact();
+    return fights;
+}
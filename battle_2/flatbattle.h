@@ -0,0 +1,78 @@
+#ifndef FLATBATTLE_H
+#define FLATBATTLE_H
+
+#include <memory>
+#include <vector>
+
+#include "battlelog.h"
+#include "imperialfleet.h"
+#include "rebelfleet.h"
+
+// Data-oriented copy of a battle's fleets. Starships are deduplicated into
+// shield and attack columns and every imperial unit becomes a list of leaf
+// handles, so the attack phase runs without virtual calls. The ship objects
+// stay authoritative: shields are read from them before each attack phase
+// and changes are written back through takeDamage afterwards. Dead units and
+// ships are dropped after each attack phase and never accessed again, as
+// SpaceBattle may release them.
+//
+// With more than one thread, large attack phases are pipelined: each thread
+// owns a block of rebels and imperial units pass through the blocks in order,
+// so every ship sees exactly the same sequence of updates as in the
+// sequential loop. This requires that no starship belongs to two imperial
+// units and no rebel is added twice; otherwise the phase runs sequentially.
+class FlatFleet {
+public:
+    // Returns nullptr if some unit is not one of the library's ship types.
+    static std::unique_ptr<FlatFleet> create(
+        const std::vector<std::shared_ptr<RebelUnit>> &rebels,
+        const std::vector<std::shared_ptr<ImperialUnit>> &imperials,
+        size_t threads = 1);
+
+    // Returns the number of fights. With an observer the phase always runs
+    // sequentially, so that events arrive in the sequential order.
+    size_t fight(BattleObserver *observer = nullptr, uint64_t tick = 0);
+
+private:
+    struct LeafHandle {
+        size_t leaf;
+        size_t count;
+    };
+
+    bool addImperial(ImperialUnit *unit);
+    bool addRebel(RebelUnit *unit);
+    void mergeHandles();
+    void load();
+    void store();
+    void damageUnit(size_t unit, AttackPower damage);
+    void aggregate(size_t unit, size_t &alive, AttackPower &power) const;
+    void compact();
+    size_t fightBlock(size_t unit, size_t begin, size_t end,
+                      BattleObserver *observer, uint64_t tick);
+    size_t fightParallel(size_t workers);
+
+    std::vector<ImperialStarship *> leafShips;
+    std::vector<ShieldPoints> leafShields;
+    std::vector<ShieldPoints> leafStored;
+    std::vector<AttackPower> leafPowers;
+
+    std::vector<LeafHandle> handles;
+    std::vector<size_t> unitBegin;
+    std::vector<size_t> units;
+
+    std::vector<RebelStarship *> rebelShips;
+    std::vector<ShieldPoints> rebelShields;
+    std::vector<ShieldPoints> rebelStored;
+    std::vector<AttackPower> rebelPowers;
+    std::vector<char> rebelArmed;
+    std::vector<size_t> rebelOrder;
+    std::vector<UnitId> rebelIds;
+
+    std::vector<size_t> liveLeaves;
+    std::vector<size_t> liveRebels;
+
+    size_t threads = 1;
+    bool disjoint = true;
+};
+
+#endif // FLATBATTLE_H
@@ -0,0 +1,121 @@
+// Compares the data-oriented engine running on several threads with the
+// sequential polymorphic one on random fleets large enough for the parallel
+// attack phase. Some fleets share a starship between imperial units or add
+// a rebel twice, which makes FlatFleet fall back to the sequential loop.
+//
+// g++ -std=c++17 -O2 -pthread flatbattle_test.cc battle.cc battlelog.cc flatbattle.cc imperialfleet.cc rebelfleet.cc -o flatbattle_test
+
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "battle.h"
+
+namespace {
+
+enum class Sharing {
+    None,
+    SharedShip,
+    DuplicateRebel
+};
+
+struct Fleet {
+    std::vector<std::shared_ptr<ImperialUnit>> imperials;
+    std::vector<std::shared_ptr<ImperialUnit>> leaves;
+    std::vector<std::shared_ptr<RebelUnit>> rebels;
+};
+
+// Builds the same fleet for the same seed, so that both engines get their
+// own copy.
+Fleet makeFleet(unsigned seed, Sharing sharing) {
+    std::mt19937 rng(seed);
+    auto random = [&rng](int lo, int hi) {
+        return std::uniform_int_distribution<int>(lo, hi)(rng);
+    };
+
+    Fleet fleet;
+    for (int i = random(100, 300); i > 0; --i) {
+        if (random(0, 3) == 0) {
+            std::vector<std::shared_ptr<ImperialUnit>> ships;
+            for (int j = random(1, 4); j > 0; --j) {
+                ships.push_back(createTIEFighter(random(1, 3000), random(0, 20)));
+                fleet.leaves.push_back(ships.back());
+            }
+            if (random(0, 1) == 0)
+                ships.push_back(ships[0]);
+            if (sharing == Sharing::SharedShip && random(0, 3) == 0)
+                ships.push_back(fleet.leaves[random(0, static_cast<int>(fleet.leaves.size()) - 1)]);
+            fleet.imperials.push_back(createSquadron({createSquadron(ships),
+                                                      createDeathStar(random(1, 5000), random(0, 30))}));
+        } else {
+            fleet.imperials.push_back(createImperialDestroyer(random(1, 5000), random(0, 30)));
+            fleet.leaves.push_back(fleet.imperials.back());
+        }
+    }
+
+    for (int i = random(700, 2000); i > 0; --i) {
+        switch (random(0, 2)) {
+            case 0: fleet.rebels.push_back(createExplorer(random(1, 3000), 300000)); break;
+            case 1: fleet.rebels.push_back(createXWing(random(1, 3000), 300000, random(0, 5))); break;
+            default: fleet.rebels.push_back(createStarCruiser(random(1, 6000), 100000, random(0, 8))); break;
+        }
+    }
+    if (sharing == Sharing::DuplicateRebel)
+        fleet.rebels.push_back(fleet.rebels[random(0, static_cast<int>(fleet.rebels.size()) - 1)]);
+    return fleet;
+}
+
+SpaceBattle build(const Fleet &fleet, bool dataOriented, size_t threads) {
+    SpaceBattle::Builder builder;
+    for (const auto &imperial : fleet.imperials)
+        builder.ship(imperial);
+    for (const auto &rebel : fleet.rebels)
+        builder.ship(rebel);
+    return builder.startTime(1).maxTime(100).dataOriented(dataOriented).threads(threads).build();
+}
+
+bool same(const Fleet &f1, const SpaceBattle &b1, const Fleet &f2, const SpaceBattle &b2) {
+    if (b1.countImperialFleet() != b2.countImperialFleet() ||
+        b1.countRebelFleet() != b2.countRebelFleet())
+        return false;
+    for (size_t i = 0; i < f1.leaves.size(); ++i) {
+        if (f1.leaves[i]->getShield() != f2.leaves[i]->getShield())
+            return false;
+    }
+    for (size_t i = 0; i < f1.rebels.size(); ++i) {
+        if (f1.rebels[i]->getShield() != f2.rebels[i]->getShield())
+            return false;
+    }
+    return true;
+}
+
+}
+
+int main() {
+    int failures = 0;
+    // The battles print their outcome on every tick once finished.
+    std::streambuf *out = std::cout.rdbuf(nullptr);
+    for (unsigned seed = 0; seed < 48; ++seed) {
+        Sharing sharing = static_cast<Sharing>(seed % 3);
+        size_t threads = 2 + seed % 7;
+        Fleet sequentialFleet = makeFleet(seed, sharing);
+        Fleet parallelFleet = makeFleet(seed, sharing);
+        SpaceBattle sequential = build(sequentialFleet, false, 1);
+        SpaceBattle parallel = build(parallelFleet, true, threads);
+        for (int t = 0; t < 40; ++t) {
+            if (!same(sequentialFleet, sequential, parallelFleet, parallel)) {
+                std::printf("FAILED: seed %u, sharing %d, %zu threads, tick %d\n",
+                            seed, static_cast<int>(sharing), threads, t);
+                ++failures;
+                break;
+            }
+            sequential.tick(1);
+            parallel.tick(1);
+        }
+    }
+    std::cout.rdbuf(out);
+    if (failures == 0)
+        std::puts("OK");
+    return failures == 0 ? 0 : 1;
+}
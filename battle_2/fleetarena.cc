@@ -0,0 +1,175 @@
+#include "fleetarena.h"
+#include <algorithm>
+#include <cassert>
+#include <new>
+#include <type_traits>
+
+namespace {
+
+const size_t minChunk = 8;
+const size_t maxChunk = 1024;
+
+template<typename T>
+class ArenaPool {
+public:
+    ArenaPool() = default;
+    ArenaPool(const ArenaPool &) = delete;
+    ArenaPool& operator=(const ArenaPool &) = delete;
+
+    ~ArenaPool() {
+        clear();
+    }
+
+    template<typename... Args>
+    T *create(Args&&... args) {
+        if (chunks.empty() || used == capacity(chunks.size() - 1)) {
+            chunks.emplace_back(new Slot[capacity(chunks.size())]);
+            used = 0;
+        }
+        T *object = new (&chunks.back()[used]) T(std::forward<Args>(args)...);
+        ++used;
+        return object;
+    }
+
+    void clear() {
+        while (!chunks.empty()) {
+            Slot *chunk = chunks.back().get();
+            while (used > 0) {
+                reinterpret_cast<T *>(&chunk[--used])->~T();
+            }
+            chunks.pop_back();
+            used = chunks.empty() ? 0 : capacity(chunks.size() - 1);
+        }
+    }
+
+private:
+    using Slot = std::aligned_storage_t<sizeof(T), alignof(T)>;
+
+    static size_t capacity(size_t chunk) {
+        return chunk < 8 ? std::min(minChunk << chunk, maxChunk) : maxChunk;
+    }
+
+    std::vector<std::unique_ptr<Slot[]>> chunks;
+    size_t used = 0;
+};
+
+}
+
+struct FleetArena::Storage {
+    ArenaPool<DeathStar> deathStars;
+    ArenaPool<ImperialDestroyer> destroyers;
+    ArenaPool<TIEFighter> fighters;
+    ArenaPool<Explorer> explorers;
+    ArenaPool<XWing> xWings;
+    ArenaPool<StarCruiser> cruisers;
+    ArenaPool<Squadron> squadrons;
+
+    ~Storage() {
+        squadrons.clear();
+    }
+
+    template<typename T>
+    ArenaPool<T> &pool();
+};
+
+template<>
+ArenaPool<DeathStar> &FleetArena::Storage::pool<DeathStar>() {
+    return deathStars;
+}
+
+template<>
+ArenaPool<ImperialDestroyer> &FleetArena::Storage::pool<ImperialDestroyer>() {
+    return destroyers;
+}
+
+template<>
+ArenaPool<TIEFighter> &FleetArena::Storage::pool<TIEFighter>() {
+    return fighters;
+}
+
+template<>
+ArenaPool<Explorer> &FleetArena::Storage::pool<Explorer>() {
+    return explorers;
+}
+
+template<>
+ArenaPool<XWing> &FleetArena::Storage::pool<XWing>() {
+    return xWings;
+}
+
+template<>
+ArenaPool<StarCruiser> &FleetArena::Storage::pool<StarCruiser>() {
+    return cruisers;
+}
+
+template<>
+ArenaPool<Squadron> &FleetArena::Storage::pool<Squadron>() {
+    return squadrons;
+}
+
+FleetArena::FleetArena() : storage(std::make_shared<Storage>()) {}
+
+bool FleetArena::holdsShipsOf(const ImperialUnit &unit, const std::shared_ptr<Storage> &storage) {
+    auto squadron = dynamic_cast<const Squadron *>(&unit);
+    if (squadron == nullptr) {
+        return false;
+    }
+    for (const auto &ship : squadron->ships) {
+        bool shared = !ship.owner_before(storage) && !storage.owner_before(ship);
+        if (shared || holdsShipsOf(*ship, storage)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<typename T, typename... Args>
+std::shared_ptr<T> arenaCreate(FleetArena &arena, Args&&... args) {
+    T *ship = arena.storage->pool<T>().create(std::forward<Args>(args)...);
+    return std::shared_ptr<T>(arena.storage, ship);
+}
+
+std::shared_ptr<ImperialUnit>
+createDeathStar(FleetArena &arena, ShieldPoints shield, AttackPower power) {
+    return arenaCreate<DeathStar>(arena, shield, power);
+}
+
+std::shared_ptr<ImperialUnit>
+createImperialDestroyer(FleetArena &arena, ShieldPoints shield, AttackPower power) {
+    return arenaCreate<ImperialDestroyer>(arena, shield, power);
+}
+
+std::shared_ptr<ImperialUnit>
+createTIEFighter(FleetArena &arena, ShieldPoints shield, AttackPower power) {
+    return arenaCreate<TIEFighter>(arena, shield, power);
+}
+
+std::shared_ptr<ImperialUnit>
+createSquadron(FleetArena &arena, const std::vector<std::shared_ptr<ImperialUnit>> &src) {
+    std::vector<std::shared_ptr<ImperialUnit>> ships;
+    ships.reserve(src.size());
+    for (const auto &ship : src) {
+        bool shared = !ship.owner_before(arena.storage) && !arena.storage.owner_before(ship);
+        assert(shared || !FleetArena::holdsShipsOf(*ship, arena.storage));
+        ships.push_back(shared ? std::shared_ptr<ImperialUnit>(std::shared_ptr<void>(), ship.get()) : ship);
+    }
+    return arenaCreate<Squadron>(arena, ships);
+}
+
+std::shared_ptr<ImperialUnit>
+createSquadron(FleetArena &arena, std::initializer_list<std::shared_ptr<ImperialUnit>> src) {
+    return createSquadron(arena, std::vector<std::shared_ptr<ImperialUnit>>(src));
+}
+
+std::shared_ptr<Explorer> createExplorer(FleetArena &arena, ShieldPoints shield, Speed speed) {
+    return arenaCreate<Explorer>(arena, shield, speed);
+}
+
+std::shared_ptr<XWing> createXWing(FleetArena &arena, ShieldPoints shield, Speed speed, AttackPower power) {
+    return arenaCreate<XWing>(arena, shield, speed, power);
+}
+
+std::shared_ptr<StarCruiser>
+createStarCruiser(FleetArena &arena, ShieldPoints shield, Speed speed, AttackPower power) {
+    return arenaCreate<StarCruiser>(arena, shield, speed, power);
+}
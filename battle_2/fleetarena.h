@@ -0,0 +1,50 @@
+#ifndef FLEETARENA_H
+#define FLEETARENA_H
+
+#include <memory>
+#include <vector>
+
+#include "imperialfleet.h"
+#include "rebelfleet.h"
+
+// Storage for ships created by the factory overloads below. Ships of each
+// class are placed contiguously in chunks instead of one allocation per
+// ship. The factories return aliasing shared_ptrs which share a single
+// reference count: all ships are destroyed together when the arena and
+// every pointer to its ships are gone.
+//
+// A squadron created in an arena does not own the members coming from the
+// same arena. Its other members must not hold ships of the arena, directly
+// or through nested squadrons, as the arena would then keep itself alive;
+// this is asserted. Squadrons are destroyed before the other ships, in
+// reverse creation order.
+class FleetArena {
+public:
+    FleetArena();
+    FleetArena(const FleetArena &) = delete;
+    FleetArena& operator=(const FleetArena &) = delete;
+
+private:
+    struct Storage;
+
+    static bool holdsShipsOf(const ImperialUnit &unit, const std::shared_ptr<Storage> &storage);
+
+    template<typename T, typename... Args>
+    friend std::shared_ptr<T> arenaCreate(FleetArena &arena, Args&&... args);
+    friend std::shared_ptr<ImperialUnit>
+    createSquadron(FleetArena &arena, const std::vector<std::shared_ptr<ImperialUnit>> &src);
+
+    std::shared_ptr<Storage> storage;
+};
+
+std::shared_ptr<ImperialUnit> createDeathStar(FleetArena &arena, ShieldPoints shield, AttackPower power);
+std::shared_ptr<ImperialUnit> createImperialDestroyer(FleetArena &arena, ShieldPoints shield, AttackPower power);
+std::shared_ptr<ImperialUnit> createTIEFighter(FleetArena &arena, ShieldPoints shield, AttackPower power);
+std::shared_ptr<ImperialUnit> createSquadron(FleetArena &arena, const std::vector<std::shared_ptr<ImperialUnit>> &src);
+std::shared_ptr<ImperialUnit> createSquadron(FleetArena &arena, std::initializer_list<std::shared_ptr<ImperialUnit>> src);
+
+std::shared_ptr<Explorer> createExplorer(FleetArena &arena, ShieldPoints shield, Speed speed);
+std::shared_ptr<XWing> createXWing(FleetArena &arena, ShieldPoints shield, Speed speed, AttackPower power);
+std::shared_ptr<StarCruiser> createStarCruiser(FleetArena &arena, ShieldPoints shield, Speed speed, AttackPower power);
+
+#endif // FLEETARENA_H
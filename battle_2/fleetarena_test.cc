@@ -0,0 +1,103 @@
+// Checks that ships created in a FleetArena are released once the arena and
+// all pointers to them are gone, and that squadrons which would make the
+// arena keep itself alive are rejected by an assertion. Run it with
+// LeakSanitizer to catch ships that are never released.
+//
+// g++ -std=c++17 -g -fsanitize=address fleetarena_test.cc fleetarena.cc battle.cc battlelog.cc flatbattle.cc imperialfleet.cc rebelfleet.cc -o fleetarena_test
+
+#include <csignal>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "battle.h"
+#include "fleetarena.h"
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char *what) {
+    if (!condition) {
+        std::printf("FAILED: %s\n", what);
+        ++failures;
+    }
+}
+
+#ifndef NDEBUG
+// Runs create in a child process and returns whether it was aborted.
+bool aborts(const std::function<void()> &create) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        std::freopen("/dev/null", "w", stderr);
+        create();
+        std::_Exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    return WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT;
+}
+#endif
+
+void released() {
+    std::weak_ptr<ImperialUnit> arenaShip, heapShip;
+    {
+        std::shared_ptr<ImperialUnit> outer;
+        SpaceBattle::Builder builder;
+        {
+            FleetArena arena;
+            auto fighter = createTIEFighter(arena, 100, 3);
+            auto outside = createTIEFighter(50, 2);
+            auto inner = createSquadron(arena, {fighter, fighter, outside});
+            auto squadron = createSquadron(arena, {inner, createDeathStar(arena, 1000, 5),
+                                                   createSquadron({createTIEFighter(20, 1)})});
+            outer = createSquadron({squadron, fighter});
+            arenaShip = fighter;
+            heapShip = outside;
+            builder.ship(squadron).ship(createXWing(arena, 500, 300000, 4))
+                   .ship(createExplorer(arena, 100, 300000));
+        }
+        SpaceBattle battle = builder.maxTime(30).dataOriented(true).build();
+        std::streambuf *out = std::cout.rdbuf(nullptr);
+        battle.run(1, 100);
+        std::cout.rdbuf(out);
+        check(!arenaShip.expired(), "ships released while in use");
+    }
+    check(arenaShip.expired(), "arena ships not released");
+    check(heapShip.expired(), "heap ships not released");
+}
+
+void cycles() {
+#ifndef NDEBUG
+    check(aborts([] {
+        FleetArena arena;
+        auto fighter = createTIEFighter(arena, 100, 3);
+        createSquadron(arena, {createSquadron({fighter})});
+    }), "heap squadron of arena ships accepted");
+
+    check(aborts([] {
+        FleetArena arena;
+        auto fighter = createTIEFighter(arena, 100, 3);
+        auto squadron = createSquadron(arena, {fighter});
+        createSquadron(arena, {createSquadron({createTIEFighter(1, 1), createSquadron({squadron})})});
+    }), "nested heap squadron of arena ships accepted");
+
+    check(aborts([] {
+        FleetArena arena, other;
+        auto fighter = createTIEFighter(arena, 100, 3);
+        createSquadron(arena, {createSquadron(other, {fighter})});
+    }), "squadron of another arena holding arena ships accepted");
+#endif
+}
+
+}
+
+int main() {
+    released();
+    cycles();
+    if (failures == 0)
+        std::puts("OK");
+    return failures == 0 ? 0 : 1;
+}
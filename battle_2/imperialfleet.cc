@@ -1,4 +1,5 @@
 #include "imperialfleet.h"
+#include <algorithm>
 #include <cassert>
 
 BasicShield::BasicShield(ShieldPoints shield) : shield(shield) {
@@ -31,9 +32,31 @@ Speed BasicEngine::getSpeed() const {
     return speed;
 }
 
+ImperialUnit::ImperialUnit(const ImperialUnit &) : Shield(), Weapon() {}
+
+ImperialUnit& ImperialUnit::operator=(const ImperialUnit &) {
+    return *this;
+}
+
+void ImperialUnit::notifyParents(ShieldPoints shieldDelta, ptrdiff_t aliveDelta,
+                                 AttackPower powerDelta) {
+    for (Squadron *parent : parents) {
+        parent->childChanged(shieldDelta, aliveDelta, powerDelta);
+    }
+}
+
 ImperialStarship::ImperialStarship(ShieldPoints shield, AttackPower power)
     : BasicShield(shield), BasicWeapon(power) {}
 
+void ImperialStarship::takeDamage(AttackPower damage) {
+    ShieldPoints before = getShield();
+    BasicShield::takeDamage(damage);
+    if (getShield() != before) {
+        bool died = before > 0 && getShield() == 0;
+        notifyParents(getShield() - before, died ? -1 : 0, died ? -getAttackPower() : 0);
+    }
+}
+
 DeathStar::DeathStar(ShieldPoints shield, AttackPower power)
     : ImperialStarship(shield, power) {}
 
@@ -44,12 +67,48 @@ ImperialDestroyer::ImperialDestroyer(ShieldPoints shield, AttackPower power)
     : ImperialStarship(shield, power) {}
 
 Squadron::Squadron(const std::vector<std::shared_ptr<ImperialUnit>> &src)
-    : ships(src) {}
+    : ships(src) {
+    link();
+}
 
 Squadron::Squadron(std::initializer_list<std::shared_ptr<ImperialUnit>> src)
-    : ships(src) {}
+    : ships(src) {
+    link();
+}
+
+Squadron::~Squadron() {
+    for (auto &ship : ships) {
+        auto &parents = ship->parents;
+        parents.erase(std::remove(parents.begin(), parents.end(), this), parents.end());
+    }
+}
+
+void Squadron::link() {
+    for (auto &ship : ships) {
+        ship->parents.push_back(this);
+        auto squadron = dynamic_cast<Squadron *>(ship.get());
+        if (squadron != nullptr ? !squadron->cached
+                                : dynamic_cast<ImperialStarship *>(ship.get()) == nullptr) {
+            cached = false;
+        }
+        shield += ship->getShield();
+        alive += ship->getAlive();
+        power += ship->getAlive() > 0 ? ship->getAttackPower() : 0;
+    }
+}
+
+void Squadron::childChanged(ShieldPoints shieldDelta, ptrdiff_t aliveDelta,
+                            AttackPower powerDelta) {
+    shield += shieldDelta;
+    alive += aliveDelta;
+    power += powerDelta;
+    notifyParents(shieldDelta, aliveDelta, powerDelta);
+}
 
 ShieldPoints Squadron::getShield() const {
+    if (cached) {
+        return shield;
+    }
     ShieldPoints ans = 0;
     for (auto &ship : ships) {
         ans += ship->getShield();
@@ -64,6 +123,9 @@ void Squadron::takeDamage(AttackPower damage) {
 }
 
 AttackPower Squadron::getAttackPower() const {
+    if (cached) {
+        return power;
+    }
     AttackPower ans = 0;
     for (auto &ship : ships) {
         ans += ship->getAlive() > 0 ? ship->getAttackPower() : 0;
@@ -72,6 +134,9 @@ AttackPower Squadron::getAttackPower() const {
 }
 
 size_t Squadron::getAlive() const {
+    if (cached) {
+        return alive;
+    }
     size_t ans = 0;
     for (auto &ship : ships) {
         ans += ship->getAlive();
@@ -1,6 +1,7 @@
 #ifndef IMPERIALFLEET_H
 #define IMPERIALFLEET_H
 
+#include <cstddef>
 #include <memory>
 #include <vector>
 
@@ -54,24 +55,49 @@ private:
     Speed speed;
 };
 
+class Squadron;
+class FleetArena;
+
 class ImperialUnit : public virtual Shield, public virtual Weapon {
+public:
+    ImperialUnit() = default;
+    ImperialUnit(const ImperialUnit &other);
+    ImperialUnit& operator=(const ImperialUnit &other);
+protected:
+    void notifyParents(ShieldPoints shieldDelta, ptrdiff_t aliveDelta, AttackPower powerDelta);
+private:
+    friend class Squadron;
+    std::vector<Squadron *> parents;
 };
 
 class ImperialStarship : public ImperialUnit, public BasicShield, public BasicWeapon {
 public:
     ImperialStarship(ShieldPoints shield, AttackPower power);
+    void takeDamage(AttackPower damage) override;
 };
 
 class Squadron : public ImperialUnit {
 public:
     Squadron(const std::vector<std::shared_ptr<ImperialUnit>> &src);
     Squadron(std::initializer_list<std::shared_ptr<ImperialUnit>> src);
+    Squadron(const Squadron &) = delete;
+    Squadron& operator=(const Squadron &) = delete;
+    ~Squadron() override;
     ShieldPoints getShield() const override;
     void takeDamage(AttackPower damage) override;
     AttackPower getAttackPower() const override;
     size_t getAlive() const override;
 private:
+    friend class FlatFleet;
+    friend class FleetArena;
+    friend class ImperialUnit;
+    void link();
+    void childChanged(ShieldPoints shieldDelta, ptrdiff_t aliveDelta, AttackPower powerDelta);
     std::vector<std::shared_ptr<ImperialUnit>> ships;
+    bool cached = true;
+    ShieldPoints shield = 0;
+    size_t alive = 0;
+    AttackPower power = 0;
 };
 
 class DeathStar : public ImperialStarship {
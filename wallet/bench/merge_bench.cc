@@ -0,0 +1,103 @@
+// Pomiar konstruktora scalającego Wallet(Wallet &&, Wallet &&) dla dużych
+// historii. Dla porównania mierzy też std::merge przez back_inserter na
+// kopiach tych samych historii, czyli scalanie bez rezerwacji.
+//
+// Z katalogu wallet/:
+// g++ -std=c++17 -O2 -pthread -I. bench/merge_bench.cc wallet.cc ledger.cc historypool.cc -o merge_bench
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <thread>
+#include <vector>
+#include "wallet.h"
+
+
+using Clock = std::chrono::steady_clock;
+
+// Minimalny łączny czas pomiaru jednego przypadku.
+static const auto minDuration = std::chrono::milliseconds(200);
+static const int maxRuns = 200;
+
+// Dopisuje do historii w jeden wpis bez zmiany stanu portfela.
+static void touch(Wallet &w) {
+    w *= 1;
+}
+
+// Tworzy dwa portfele z historiami po n wpisów. Przy interleaved wpisy są
+// dopisywane na przemian przez co najmniej dwie milisekundy, więc historie
+// przeplatają się w czasie; wpp. druga historia jest w całości późniejsza.
+static void build(size_t n, bool interleaved, Wallet &w1, Wallet &w2) {
+    w1 = Wallet(1);
+    w2 = Wallet(2);
+    for (size_t i = 1; i < n; ++i) {
+        if (interleaved && i == n / 2)
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        touch(w1);
+        if (interleaved)
+            touch(w2);
+    }
+    if (!interleaved) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        for (size_t i = 1; i < n; ++i)
+            touch(w2);
+    }
+}
+
+static std::vector<Operation> copyHistory(const Wallet &w) {
+    std::vector<Operation> ans;
+    ans.reserve(w.opSize());
+    for (size_t i = 0; i < w.opSize(); ++i)
+        ans.push_back(w[i]);
+    return ans;
+}
+
+static double nanos(Clock::duration d) {
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+}
+
+static void run(size_t n, bool interleaved) {
+    Clock::duration mergeTime{}, referenceTime{};
+    uint64_t allocations = 0;
+    int runs = 0;
+    while (runs < maxRuns && (runs < 3 || mergeTime < minDuration)) {
+        Wallet w1, w2;
+        build(n, interleaved, w1, w2);
+        std::vector<Operation> h1 = copyHistory(w1);
+        std::vector<Operation> h2 = copyHistory(w2);
+
+        auto start = Clock::now();
+        std::vector<Operation> merged;
+        std::merge(h1.begin(), h1.end(), h2.begin(), h2.end(), std::back_inserter(merged));
+        referenceTime += Clock::now() - start;
+
+        HistoryPool::resetStats();
+        start = Clock::now();
+        Wallet w0(std::move(w1), std::move(w2));
+        mergeTime += Clock::now() - start;
+        HistoryPool::Stats stats = HistoryPool::stats();
+        allocations += stats.heapAllocations + stats.reused;
+
+        if (w0.opSize() != merged.size() + 1)
+            std::fprintf(stderr, "unexpected history size %zu\n", w0.opSize());
+        ++runs;
+    }
+
+    double entries = 2.0 * static_cast<double>(n);
+    std::printf("%-12s %8zu %12.1f %12.2f %12.2f %10.2f\n",
+                interleaved ? "interleaved" : "disjoint", n,
+                nanos(mergeTime) / runs / 1000.0,
+                nanos(mergeTime) / runs / entries,
+                nanos(referenceTime) / runs / entries,
+                static_cast<double>(allocations) / runs);
+}
+
+int main() {
+    std::printf("%-12s %8s %12s %12s %12s %10s\n",
+                "case", "entries", "us/merge", "ns/entry", "std::merge", "allocs");
+    for (size_t n : {1000, 10000, 100000, 1000000}) {
+        run(n, false);
+        run(n, true);
+    }
+}
@@ -0,0 +1,277 @@
+// Mikrobenchmarki portfeli: parsowanie, łańcuchy operatorów arytmetycznych,
+// przypisanie przenoszące, konstruktor scalający i wypisywanie. Dla każdego
+// przypadku podaje czas jednej operacji, liczbę przydziałów buforów historii
+// ze sterty na operację i osobno liczbę buforów wydanych ponownie z listy
+// wolnych HistoryPool (z HistoryPool::stats()) oraz rozmiar historii
+// portfela wynikowego (Wallet::historyBytes()).
+//
+// Z katalogu wallet/:
+// g++ -std=c++17 -O2 -pthread -I. bench/wallet_bench.cc wallet.cc ledger.cc historypool.cc -o wallet_bench
+//
+// ./wallet_bench [--coarse-clock] [--json out.json] [--baseline base.json] [--tolerance 0.15]
+//
+// --json zapisuje wyniki w formacie JSON, --baseline porównuje je z wcześniej
+// zapisanymi wynikami (np. bench/baseline.json) i kończy program kodem 1,
+// jeżeli czas któregoś przypadku wzrósł o więcej niż tolerance albo wzrosła
+// liczba przydziałów ze sterty.
+//
+// Czasy zależą od maszyny: bench/baseline.json pochodzi z jednej maszyny
+// i przed porównywaniem na innej należy go wygenerować ponownie (--json)
+// z wersji bazowej. Liczby przydziałów nie zależą od maszyny.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "wallet.h"
+
+
+using Clock = std::chrono::steady_clock;
+
+static const auto minDuration = std::chrono::milliseconds(200);
+
+struct Result {
+    std::string name;
+    double nsPerOp;
+    double allocsPerOp;
+    double reusedPerOp;
+    double historyBytes;
+};
+
+// Zapobiega usunięciu mierzonego kodu przez kompilator.
+static volatile size_t sink;
+
+// Mierzy op, które wykonuje jedną operację i zwraca historyBytes() portfela
+// wynikowego. Liczba powtórzeń jest podwajana do osiągnięcia minDuration.
+template<typename F>
+static Result measure(const char *name, F op) {
+    for (int i = 0; i < 1000; ++i)
+        sink = op();
+
+    size_t iterations = 1000;
+    for (;;) {
+        size_t bytes = 0;
+        HistoryPool::resetStats();
+        auto start = Clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+            bytes += op();
+        auto elapsed = Clock::now() - start;
+        HistoryPool::Stats stats = HistoryPool::stats();
+        sink = bytes;
+
+        if (elapsed >= minDuration) {
+            double n = static_cast<double>(iterations);
+            double ns = static_cast<double>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+            return Result{name, ns / n,
+                          static_cast<double>(stats.heapAllocations) / n,
+                          static_cast<double>(stats.reused) / n,
+                          static_cast<double>(bytes) / n};
+        }
+        iterations *= 2;
+    }
+}
+
+static std::vector<Result> runAll() {
+    std::vector<Result> results;
+
+    results.push_back(measure("parse_decimal", [] {
+        Wallet w("  1234567,89012345 ");
+        return w.historyBytes();
+    }));
+
+    results.push_back(measure("parse_binary", [] {
+        Wallet w = Wallet::fromBinary("101101011010110");
+        return w.historyBytes();
+    }));
+
+    results.push_back(measure("add_chain", [] {
+        Wallet w = Wallet(1) + Wallet(2) + Wallet(3) + Wallet(4);
+        return w.historyBytes();
+    }));
+
+    results.push_back(measure("sub_chain", [] {
+        Wallet w = Wallet(10) - Wallet(1) - Wallet(2) - Wallet(3);
+        return w.historyBytes();
+    }));
+
+    results.push_back(measure("mul_chain", [] {
+        Wallet w(1);
+        w *= 2;
+        Wallet v = 3 * (2 * w);
+        return v.historyBytes();
+    }));
+
+    {
+        Wallet w;
+        results.push_back(measure("move_assign", [&w] {
+            w = Wallet(1);
+            return w.historyBytes();
+        }));
+    }
+
+    results.push_back(measure("merge", [] {
+        Wallet w(Wallet(1), Wallet(2));
+        return w.historyBytes();
+    }));
+
+    {
+        Wallet w("1234,5678");
+        std::ostringstream os;
+        results.push_back(measure("format_wallet", [&w, &os] {
+            os.str(std::string());
+            os << w;
+            return w.historyBytes();
+        }));
+    }
+
+    {
+        Wallet w("1234,5678");
+        std::ostringstream os;
+        results.push_back(measure("format_operation", [&w, &os] {
+            os.str(std::string());
+            os << w[0];
+            return w.historyBytes();
+        }));
+    }
+
+    return results;
+}
+
+static void print(const std::vector<Result> &results) {
+    std::printf("%-18s %12s %12s %12s %14s\n",
+                "benchmark", "ns/op", "allocs/op", "reused/op", "history bytes");
+    for (const Result &r : results)
+        std::printf("%-18s %12.1f %12.2f %12.2f %14.1f\n",
+                    r.name.c_str(), r.nsPerOp, r.allocsPerOp, r.reusedPerOp, r.historyBytes);
+}
+
+static bool writeJson(const std::string &path, const std::vector<Result> &results) {
+    std::ofstream out(path);
+    out << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &r = results[i];
+        char line[256];
+        std::snprintf(line, sizeof(line),
+                      "    {\"name\": \"%s\", \"ns_per_op\": %.2f, \"allocs_per_op\": %.3f, "
+                      "\"reused_per_op\": %.3f, \"history_bytes\": %.1f}%s\n",
+                      r.name.c_str(), r.nsPerOp, r.allocsPerOp, r.reusedPerOp, r.historyBytes,
+                      i + 1 < results.size() ? "," : "");
+        out << line;
+    }
+    out << "  ]\n}\n";
+    return out.good();
+}
+
+// Zwraca wartość liczbową klucza key z wiersza line albo NAN.
+static double jsonNumber(const std::string &line, const char *key) {
+    std::string pattern = std::string("\"") + key + "\":";
+    size_t pos = line.find(pattern);
+    if (pos == std::string::npos)
+        return NAN;
+    return std::strtod(line.c_str() + pos + pattern.size(), nullptr);
+}
+
+// Wczytuje wyniki zapisane przez writeJson (jeden przypadek w wierszu).
+static bool readJson(const std::string &path, std::vector<Result> &results) {
+    std::ifstream in(path);
+    if (!in)
+        return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t pos = line.find("\"name\": \"");
+        if (pos == std::string::npos)
+            continue;
+        pos += std::strlen("\"name\": \"");
+        size_t end = line.find('"', pos);
+        if (end == std::string::npos)
+            return false;
+        results.push_back(Result{line.substr(pos, end - pos),
+                                 jsonNumber(line, "ns_per_op"),
+                                 jsonNumber(line, "allocs_per_op"),
+                                 jsonNumber(line, "reused_per_op"),
+                                 jsonNumber(line, "history_bytes")});
+    }
+    return true;
+}
+
+// Wypisuje porównanie z wynikami bazowymi i zwraca liczbę regresji.
+static int compare(const std::vector<Result> &baseline, const std::vector<Result> &results,
+                   double tolerance) {
+    int regressions = 0;
+    std::printf("\n%-18s %12s %12s %9s %12s %12s\n",
+                "benchmark", "base ns/op", "ns/op", "change", "base allocs", "allocs");
+    for (const Result &base : baseline) {
+        const Result *current = nullptr;
+        for (const Result &r : results) {
+            if (r.name == base.name)
+                current = &r;
+        }
+        if (current == nullptr) {
+            std::printf("%-18s missing\n", base.name.c_str());
+            ++regressions;
+            continue;
+        }
+        double change = current->nsPerOp / base.nsPerOp - 1.0;
+        bool slower = change > tolerance;
+        bool moreAllocs = current->allocsPerOp > base.allocsPerOp + 0.005;
+        std::printf("%-18s %12.1f %12.1f %+8.1f%% %12.2f %12.2f%s\n",
+                    base.name.c_str(), base.nsPerOp, current->nsPerOp, 100.0 * change,
+                    base.allocsPerOp, current->allocsPerOp,
+                    slower || moreAllocs ? "  REGRESSION" : "");
+        regressions += slower || moreAllocs;
+    }
+    return regressions;
+}
+
+int main(int argc, char **argv) {
+    std::string jsonPath, baselinePath;
+    double tolerance = 0.15;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--coarse-clock") {
+            Operation::useCoarseClock(true);
+        } else if (arg == "--json" && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else if (arg == "--baseline" && i + 1 < argc) {
+            baselinePath = argv[++i];
+        } else if (arg == "--tolerance" && i + 1 < argc) {
+            tolerance = std::atof(argv[++i]);
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--coarse-clock] [--json out.json]"
+                      << " [--baseline base.json] [--tolerance 0.15]\n"
+                      << "The baseline timings are machine-specific; regenerate"
+                      << " base.json with --json on each machine.\n";
+            return 2;
+        }
+    }
+
+    std::vector<Result> results = runAll();
+    print(results);
+
+    if (!jsonPath.empty() && !writeJson(jsonPath, results)) {
+        std::cerr << "cannot write " << jsonPath << "\n";
+        return 2;
+    }
+
+    if (!baselinePath.empty()) {
+        std::vector<Result> baseline;
+        if (!readJson(baselinePath, baseline)) {
+            std::cerr << "cannot read " << baselinePath << "\n";
+            return 2;
+        }
+        int regressions = compare(baseline, results, tolerance);
+        if (regressions > 0) {
+            std::printf("%d regression(s)\n", regressions);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include <atomic>
+#include <new>
+#include "historypool.h"
+
+
+// Najmniejszy przydzielany bufor i liczba klas rozmiarów (64 B, 128 B, ...,
+// maxPooledSize).
+static const size_t minPooledSize = 64;
+static const size_t sizeClasses = 11;
+// Maksymalna liczba wolnych buforów jednej klasy w jednym wątku.
+static const size_t maxCachedBlocks = 64;
+
+static_assert(minPooledSize << (sizeClasses - 1) == HistoryPool::maxPooledSize,
+              "Size classes do not cover maxPooledSize");
+
+static std::atomic<bool> poolEnabled(true);
+static std::atomic<uint64_t> heapAllocations(0);
+static std::atomic<uint64_t> reused(0);
+static std::atomic<uint64_t> deallocations(0);
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Listy wolnych buforów
+
+
+namespace {
+
+struct FreeBlock {
+    FreeBlock *next;
+};
+
+// Listy wolnych buforów wątku. Struktura jest trywialnie destruowalna, więc
+// pozostaje dostępna również dla portfeli niszczonych po zakończeniu wątku
+// (np. statycznych); wtedy closed jest ustawione i bufory idą na stertę.
+struct ThreadCache {
+    FreeBlock *head[sizeClasses];
+    size_t count[sizeClasses];
+    bool closed;
+};
+
+thread_local ThreadCache cache;
+
+// Zwalnia bufory z listy przy zakończeniu wątku.
+struct ThreadCacheGuard {
+
+    ThreadCacheGuard() {
+        cache.closed = false;
+    }
+
+    ~ThreadCacheGuard() {
+        cache.closed = true;
+        for (size_t c = 0; c < sizeClasses; ++c) {
+            while (cache.head[c] != nullptr) {
+                FreeBlock *block = cache.head[c];
+                cache.head[c] = block->next;
+                ::operator delete(block);
+            }
+            cache.count[c] = 0;
+        }
+    }
+
+};
+
+// Zwraca listy wolnych buforów bieżącego wątku albo nullptr, jeśli zostały
+// już zamknięte.
+ThreadCache *threadCache() {
+    static thread_local ThreadCacheGuard guard;
+    return cache.closed ? nullptr : &cache;
+}
+
+// Zwraca klasę rozmiaru bytes; bufory klasy c mają minPooledSize << c bajtów.
+size_t sizeClass(size_t bytes) {
+    size_t c = 0;
+    while ((minPooledSize << c) < bytes)
+        ++c;
+    return c;
+}
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Przydział i zwalnianie
+
+
+void *HistoryPool::allocate(size_t bytes) {
+    if (bytes > maxPooledSize) {
+        heapAllocations.fetch_add(1, std::memory_order_relaxed);
+        return ::operator new(bytes);
+    }
+
+    size_t c = sizeClass(bytes);
+    ThreadCache *tc = threadCache();
+    if (tc != nullptr && tc->head[c] != nullptr) {
+        FreeBlock *block = tc->head[c];
+        tc->head[c] = block->next;
+        --tc->count[c];
+        reused.fetch_add(1, std::memory_order_relaxed);
+        return block;
+    }
+
+    // Przydzielamy cały bufor klasy, by mógł potem obsłużyć każdy przydział
+    // tej klasy.
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    return ::operator new(minPooledSize << c);
+}
+
+void HistoryPool::deallocate(void *p, size_t bytes) noexcept {
+    deallocations.fetch_add(1, std::memory_order_relaxed);
+    if (bytes <= maxPooledSize && poolEnabled.load(std::memory_order_relaxed)) {
+        size_t c = sizeClass(bytes);
+        ThreadCache *tc = threadCache();
+        if (tc != nullptr && tc->count[c] < maxCachedBlocks) {
+            FreeBlock *block = static_cast<FreeBlock *>(p);
+            block->next = tc->head[c];
+            tc->head[c] = block;
+            ++tc->count[c];
+            return;
+        }
+    }
+    ::operator delete(p);
+}
+
+void HistoryPool::setEnabled(bool enabled) {
+    poolEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+HistoryPool::Stats HistoryPool::stats() {
+    return Stats{heapAllocations.load(std::memory_order_relaxed),
+                 reused.load(std::memory_order_relaxed),
+                 deallocations.load(std::memory_order_relaxed)};
+}
+
+void HistoryPool::resetStats() {
+    heapAllocations.store(0, std::memory_order_relaxed);
+    reused.store(0, std::memory_order_relaxed);
+    deallocations.store(0, std::memory_order_relaxed);
+}
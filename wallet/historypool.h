@@ -0,0 +1,79 @@
+#ifndef HISTORYPOOL_H
+#define HISTORYPOOL_H
+
+
+#include <cstddef>
+#include <cstdint>
+
+
+// Pula buforów historii portfeli. Rozmiary buforów są zaokrąglane w górę do
+// potęgi dwójki; zwolnione bufory nie większe niż maxPooledSize trafiają na
+// listę wolnych buforów bieżącego wątku i są ponownie wydawane przy kolejnym
+// przydziale tego samego rozmiaru, bez odwoływania się do sterty. Bufor może
+// zostać zwolniony w innym wątku niż ten, w którym go przydzielono.
+class HistoryPool {
+
+public:
+
+    static const size_t maxPooledSize = 64 * 1024;
+
+    // Liczniki przydziałów, wspólne dla wszystkich wątków.
+    struct Stats {
+        // Przydziały obsłużone przez stertę.
+        uint64_t heapAllocations;
+        // Przydziały obsłużone buforem z listy wolnych.
+        uint64_t reused;
+        // Wszystkie zwolnienia.
+        uint64_t deallocations;
+    };
+
+    static void *allocate(size_t bytes);
+
+    static void deallocate(void *p, size_t bytes) noexcept;
+
+    // Włącza lub wyłącza zachowywanie zwolnionych buforów (domyślnie
+    // włączone). Po wyłączeniu bufory są zwracane na stertę.
+    static void setEnabled(bool enabled);
+
+    static Stats stats();
+
+    static void resetStats();
+
+};
+
+
+// Bezstanowy alokator przydzielający pamięć z HistoryPool.
+template<typename T>
+class HistoryAllocator {
+
+public:
+
+    using value_type = T;
+
+    HistoryAllocator() noexcept = default;
+
+    template<typename U>
+    HistoryAllocator(const HistoryAllocator<U> &) noexcept {}
+
+    T *allocate(size_t n) {
+        return static_cast<T *>(HistoryPool::allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n) noexcept {
+        HistoryPool::deallocate(p, n * sizeof(T));
+    }
+
+};
+
+template<typename T, typename U>
+bool operator==(const HistoryAllocator<T> &, const HistoryAllocator<U> &) {
+    return true;
+}
+
+template<typename T, typename U>
+bool operator!=(const HistoryAllocator<T> &, const HistoryAllocator<U> &) {
+    return false;
+}
+
+
+#endif // HISTORYPOOL_H
@@ -0,0 +1,207 @@
+#include <atomic>
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/vfs.h>
+#endif
+#include "ledger.h"
+#include "wallet.h"
+
+
+static const uint64_t ledgerMagic = 0x314c41574a4e5031; // "1PNJWAL1"
+static const size_t initialCapacity = 4096;
+
+
+struct Ledger::Header {
+    uint64_t magic;
+    // Liczba rekordów, których zapis się zakończył.
+    uint64_t count;
+    // Najmniejszy identyfikator portfela niewystępujący w dzienniku.
+    uint64_t nextWallet;
+    uint64_t reserved;
+};
+
+
+static void throwErrno(const char *what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+// Odrzuca sieciowe systemy plików, na których mmap nie jest spójny.
+static void checkLocalFilesystem(int fd) {
+#ifdef __linux__
+    static const long remoteMagics[] = {
+        0x6969,             // NFS
+        0x517b,             // SMB
+        (long) 0xff534d42,  // CIFS
+        (long) 0xfe534d42,  // SMB2
+    };
+    struct statfs fs;
+    if (fstatfs(fd, &fs) != 0)
+        throwErrno("Ledger: fstatfs failed");
+    for (long magic : remoteMagics) {
+        if (static_cast<long>(fs.f_type) == magic)
+            throw std::runtime_error("Ledger must be stored on a local filesystem");
+    }
+#else
+    (void) fd;
+#endif
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Odwzorowanie pliku
+
+
+// Poprzednie odwzorowanie jest zwalniane dopiero po utworzeniu nowego, więc
+// przy błędzie dziennik pozostaje w poprzednim stanie.
+void Ledger::map(size_t size) {
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+        throwErrno("Ledger: ftruncate failed");
+    void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+        throwErrno("Ledger: mmap failed");
+    if (header != nullptr)
+        munmap(header, mappedSize);
+    mappedSize = size;
+    header = static_cast<Header *>(p);
+    records = reinterpret_cast<LedgerRecord *>(header + 1);
+}
+
+// Podwaja pojemność pliku.
+void Ledger::grow() {
+    map(sizeof(Header) + 2 * (mappedSize - sizeof(Header)));
+}
+
+Ledger::Ledger(const std::string &path)
+        : fd(-1), mappedSize(0), header(nullptr), records(nullptr), units(0) {
+    fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        throwErrno("Ledger: open failed");
+
+    try {
+        checkLocalFilesystem(fd);
+
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+            throwErrno("Ledger: fstat failed");
+        size_t size = static_cast<size_t>(st.st_size);
+
+        if (size == 0) {
+            map(sizeof(Header) + initialCapacity * sizeof(LedgerRecord));
+            *header = Header{ledgerMagic, 0, 1, 0};
+        } else {
+            if (size < sizeof(Header) + sizeof(LedgerRecord))
+                throw std::runtime_error("Ledger: file too short");
+            map(size);
+            uint64_t capacity = (size - sizeof(Header)) / sizeof(LedgerRecord);
+            if (header->magic != ledgerMagic || header->count > capacity)
+                throw std::runtime_error("Ledger: not a valid ledger file");
+        }
+    } catch (...) {
+        if (header != nullptr)
+            munmap(header, mappedSize);
+        close(fd);
+        throw;
+    }
+
+    // Odtwarzamy ostatnie stany portfeli.
+    uint64_t count = header->count;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    for (uint64_t i = 0; i < count; ++i) {
+        const LedgerRecord &r = records[i];
+        auto it = lastRecord.find(r.wallet);
+        if (it != lastRecord.end()) {
+            units -= records[it->second].units;
+            it->second = i;
+        } else {
+            lastRecord.emplace(r.wallet, i);
+        }
+        units += r.units;
+    }
+}
+
+Ledger::~Ledger() {
+    Wallet::detachLedger(*this);
+    msync(header, mappedSize, MS_SYNC);
+    munmap(header, mappedSize);
+    close(fd);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Zapis i odczyt
+
+
+void Ledger::append(uint64_t wallet, int64_t timestamp, uint64_t units) noexcept {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (error)
+        return;
+    uint64_t count = header->count;
+    uint64_t *last;
+    try {
+        if (sizeof(Header) + (count + 1) * sizeof(LedgerRecord) > mappedSize)
+            grow();
+        last = &lastRecord.emplace(wallet, noRecord).first->second;
+    } catch (...) {
+        // Dopisywanie jest wywoływane także z przenoszących konstruktorów
+        // i przypisania portfela, więc błąd zapamiętujemy do sync().
+        error = std::current_exception();
+        return;
+    }
+
+    if (*last != noRecord)
+        this->units -= records[*last].units;
+    this->units += units;
+
+    records[count] = LedgerRecord{wallet, timestamp, units, *last};
+    *last = count;
+    // Licznik zwiększamy dopiero po zapisaniu rekordu, więc przerwany zapis
+    // nie zostanie odtworzony. Bariera zapobiega przestawieniu zapisów.
+    std::atomic_thread_fence(std::memory_order_release);
+    header->count = count + 1;
+    if (wallet >= header->nextWallet)
+        header->nextWallet = wallet + 1;
+}
+
+uint64_t Ledger::size() const {
+    return header->count;
+}
+
+const LedgerRecord &Ledger::operator[](uint64_t k) const {
+    if (k >= header->count)
+        throw std::out_of_range("Ledger record index out of range");
+    return records[k];
+}
+
+uint64_t Ledger::last(uint64_t wallet) const {
+    auto it = lastRecord.find(wallet);
+    return it == lastRecord.end() ? noRecord : it->second;
+}
+
+Ledger::History Ledger::history(uint64_t wallet) const {
+    return History(HistoryIterator(records, last(wallet)));
+}
+
+uint64_t Ledger::liveUnits() const {
+    return units;
+}
+
+uint64_t Ledger::nextWalletId() const {
+    return header->nextWallet;
+}
+
+bool Ledger::good() const {
+    return !error;
+}
+
+void Ledger::sync() {
+    if (error)
+        std::rethrow_exception(error);
+    if (msync(header, mappedSize, MS_SYNC) != 0)
+        throwErrno("Ledger: msync failed");
+}
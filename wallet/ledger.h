@@ -0,0 +1,163 @@
+#ifndef LEDGER_H
+#define LEDGER_H
+
+
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+
+// Rekord dziennika: stan portfela po jednej operacji.
+struct LedgerRecord {
+    // Identyfikator portfela (Wallet::getId()).
+    uint64_t wallet;
+    // Czas wykonania operacji w milisekundach od epoki.
+    int64_t timestamp;
+    // Liczba jednostek w portfelu po operacji.
+    uint64_t units;
+    // Indeks poprzedniego rekordu tego samego portfela albo Ledger::noRecord.
+    uint64_t previous;
+};
+
+
+// Dziennik operacji na portfelach, dopisywany na końcu pliku odwzorowanego
+// w pamięci (mmap). Każdy wpis w historii portfela podłączonego dziennika
+// (zob. Wallet::attachLedger) staje się jednym rekordem o stałym rozmiarze.
+// Rekordy jednego portfela tworzą listę połączoną od najnowszego do
+// najstarszego, więc historię portfela można przeglądać bezpośrednio
+// w odwzorowanym pliku, bez kopiowania jej na stertę.
+//
+// Plik musi leżeć w lokalnym systemie plików: dziennik nie synchronizuje
+// dostępu między procesami, a sieciowe systemy plików nie gwarantują
+// spójności odwzorowań. Po awarii procesu odtwarzane są wszystkie rekordy,
+// których zapis się zakończył. Odporność na awarię systemu wymaga
+// wywołania sync().
+//
+// Wskaźniki i referencje do rekordów tracą ważność po każdym append().
+class Ledger {
+
+    struct Header;
+
+    int fd;
+    size_t mappedSize;
+    Header *header;
+    LedgerRecord *records;
+
+    // Indeks ostatniego rekordu każdego portfela.
+    std::unordered_map<uint64_t, uint64_t> lastRecord;
+    // Suma jednostek we wszystkich portfelach według ostatnich rekordów.
+    uint64_t units;
+
+    // Chroni dopisywanie rekordów przez współbieżne paczki przelewów.
+    std::mutex mutex;
+
+    // Pierwszy błąd dopisywania; po nim kolejne rekordy są pomijane.
+    std::exception_ptr error;
+
+    void map(size_t size);
+
+    void grow();
+
+public:
+
+    static constexpr uint64_t noRecord = UINT64_MAX;
+
+    // Przegląda rekordy jednego portfela od najnowszego do najstarszego.
+    class HistoryIterator {
+
+        const LedgerRecord *records;
+        uint64_t index;
+
+    public:
+
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = LedgerRecord;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const LedgerRecord *;
+        using reference = const LedgerRecord &;
+
+        HistoryIterator(const LedgerRecord *records, uint64_t index)
+                : records(records), index(index) {}
+
+        reference operator*() const { return records[index]; }
+        pointer operator->() const { return &records[index]; }
+
+        HistoryIterator &operator++() {
+            index = records[index].previous;
+            return *this;
+        }
+
+        HistoryIterator operator++(int) {
+            HistoryIterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const HistoryIterator &it) const { return index == it.index; }
+        bool operator!=(const HistoryIterator &it) const { return index != it.index; }
+
+    };
+
+    class History {
+
+        HistoryIterator first;
+
+    public:
+
+        explicit History(HistoryIterator first) : first(first) {}
+
+        HistoryIterator begin() const { return first; }
+        HistoryIterator end() const { return HistoryIterator(nullptr, noRecord); }
+
+    };
+
+    // Otwiera dziennik z pliku path albo tworzy nowy, jeżeli plik nie istnieje.
+    // Odtwarza ostatnie stany wszystkich portfeli. Zgłasza std::system_error
+    // przy błędach systemowych i std::runtime_error, gdy plik nie jest
+    // poprawnym dziennikiem lub nie leży w lokalnym systemie plików.
+    explicit Ledger(const std::string &path);
+
+    // Odłącza dziennik od portfeli (jeśli był podłączony) i zamyka plik.
+    ~Ledger();
+
+    Ledger(const Ledger &) = delete;
+    Ledger &operator=(const Ledger &) = delete;
+
+    // Dopisuje rekord dla portfela wallet. Można wywoływać współbieżnie,
+    // ale nie równolegle z odczytem dziennika. Nie zgłasza wyjątków: jeżeli
+    // nie uda się powiększyć pliku (np. brak miejsca na dysku), rekord
+    // i wszystkie kolejne są pomijane, a błąd zgłasza sync().
+    void append(uint64_t wallet, int64_t timestamp, uint64_t units) noexcept;
+
+    // Zwraca liczbę rekordów w dzienniku.
+    uint64_t size() const;
+
+    // Zwraca k-ty rekord dziennika.
+    const LedgerRecord &operator[](uint64_t k) const;
+
+    // Zwraca indeks ostatniego rekordu portfela wallet albo noRecord.
+    uint64_t last(uint64_t wallet) const;
+
+    // Zwraca rekordy portfela wallet, od najnowszego.
+    History history(uint64_t wallet) const;
+
+    // Zwraca sumę jednostek we wszystkich portfelach według dziennika.
+    uint64_t liveUnits() const;
+
+    // Zwraca najmniejszy identyfikator portfela niewystępujący w dzienniku.
+    uint64_t nextWalletId() const;
+
+    // Zwraca false, jeżeli któryś rekord nie został dopisany.
+    bool good() const;
+
+    // Zapisuje zmiany na dysk. Zgłasza pierwszy błąd dopisywania, jeżeli
+    // wystąpił.
+    void sync();
+
+};
+
+
+#endif // LEDGER_H
@@ -0,0 +1,195 @@
+// Test odtwarzania dziennika po awarii i po zwykłym zakończeniu procesu.
+// Każdy scenariusz działa w procesie potomnym, który kończy się przez _Exit
+// bez niszczenia portfeli albo przez exit po zniszczeniu portfeli i dziennika,
+// a proces macierzysty otwiera dziennik i sprawdza odtworzony stan.
+//
+// g++ -std=c++17 -O2 -pthread ledger_test.cc ledger.cc wallet.cc historypool.cc -o ledger_test
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ledger.h"
+#include "wallet.h"
+
+
+static const uint64_t B = jnp_wallet_::decimalShift;
+
+// Parsery literałów muszą pozostać wyrażeniami stałymi.
+static_assert(jnp_wallet_::parseString("1.5") == 150000000);
+static_assert(jnp_wallet_::parseString(" 0,00000001 ") == 1);
+static_assert(jnp_wallet_::parseBinaryString("101") == 5 * jnp_wallet_::decimalShift);
+
+static int failures = 0;
+
+static void check(bool condition, const std::string &what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << "\n";
+        ++failures;
+    }
+}
+
+static int resultPipe = -1;
+
+// Przekazuje values procesowi macierzystemu i kończy proces bez niszczenia
+// portfeli ani dziennika.
+static void crashNow(const std::vector<uint64_t> &values) {
+    size_t size = values.size() * sizeof(uint64_t);
+    bool written = write(resultPipe, values.data(), size) == static_cast<ssize_t>(size);
+    std::_Exit(written ? 0 : 1);
+}
+
+// Uruchamia child w procesie potomnym, który przekazuje wartości przez
+// resultPipe. Zwraca przekazane wartości albo pusty wektor, jeżeli proces
+// potomny nie zakończył się kodem 0.
+static std::vector<uint64_t> inChild(const std::function<void()> &child) {
+    int fds[2];
+    if (pipe(fds) != 0)
+        return {};
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        resultPipe = fds[1];
+        child();
+        std::_Exit(1);
+    }
+    close(fds[1]);
+    std::vector<uint64_t> values;
+    uint64_t value;
+    while (read(fds[0], &value, sizeof(value)) == sizeof(value))
+        values.push_back(value);
+    close(fds[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        return {};
+    return values;
+}
+
+// Uruchamia scenario w procesie potomnym z nowym dziennikiem path.
+// Scenariusz kończy się wywołaniem crashNow.
+static std::vector<uint64_t> crash(const std::string &path,
+                                   const std::function<void(Ledger &)> &scenario) {
+    std::remove(path.c_str());
+    return inChild([&] {
+        Ledger ledger(path);
+        Wallet::attachLedger(ledger);
+        scenario(ledger);
+    });
+}
+
+// Uruchamia scenario w procesie potomnym z nowym dziennikiem path, po czym
+// niszczy dziennik i kończy proces przez exit. Portfele scenariusza są
+// niszczone przed dziennikiem, jak przy zwykłej kolejności deklaracji.
+static std::vector<uint64_t> exitNormally(const std::string &path,
+                                          const std::function<std::vector<uint64_t>()> &scenario) {
+    std::remove(path.c_str());
+    return inChild([&] {
+        std::vector<uint64_t> values;
+        {
+            Ledger ledger(path);
+            Wallet::attachLedger(ledger);
+            values = scenario();
+        }
+        size_t size = values.size() * sizeof(uint64_t);
+        bool written = write(resultPipe, values.data(), size) == static_cast<ssize_t>(size);
+        std::exit(written ? 0 : 1);
+    });
+}
+
+// Otwiera dziennik w procesie potomnym i sprawdza, że wszystkie odtworzone
+// jednostki mieszczą się w limicie, a portfel id ma units jednostek.
+static void verify(const std::string &path, const std::string &name,
+                   uint64_t liveUnits, uint64_t id, uint64_t units) {
+    Ledger ledger(path);
+    check(ledger.liveUnits() == liveUnits, name + ": liveUnits " +
+          std::to_string(ledger.liveUnits()) + " != " + std::to_string(liveUnits));
+    check(ledger.nextWalletId() > id, name + ": nextWalletId");
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        Wallet::attachLedger(ledger);
+        Wallet w = Wallet::reopen(id);
+        std::_Exit(w.getUnits() == units ? 0 : 1);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    check(WIFEXITED(status) && WEXITSTATUS(status) == 0, name + ": reopen");
+}
+
+int main() {
+    std::string path = "/tmp/ledger_test_" + std::to_string(getpid()) + ".ledger";
+
+    auto ids = crash(path, [](Ledger &) {
+        Wallet a = 2.0_B;
+        a += 101_Bbin;
+        Wallet b = std::move(a);
+        crashNow({b.getId()});
+    });
+    check(ids.size() == 1, "move: child");
+    if (ids.size() == 1)
+        verify(path, "move", 7 * B, ids[0], 7 * B);
+
+    ids = crash(path, [](Ledger &) {
+        Wallet w1(5), w2(7);
+        Wallet m(std::move(w1), std::move(w2));
+        crashNow({m.getId()});
+    });
+    check(ids.size() == 1, "merge: child");
+    if (ids.size() == 1)
+        verify(path, "merge", 12 * B, ids[0], 12 * B);
+
+    // Wymusza kilkukrotne powiększenie pliku.
+    ids = crash(path, [](Ledger &) {
+        Wallet a(1), b;
+        for (int i = 0; i < 10000; ++i)
+            a -= b;
+        crashNow({a.getId()});
+    });
+    check(ids.size() == 1, "grow: child");
+    if (ids.size() == 1)
+        verify(path, "grow", 1 * B, ids[0], 1 * B);
+
+    // Zniszczenie portfela nie zamyka go w dzienniku; jednostki przepadają
+    // tylko po opróżnieniu portfela.
+    ids = exitNormally(path, [] {
+        Wallet w(5), spent(3);
+        spent *= 0;
+        return std::vector<uint64_t>{w.getId()};
+    });
+    check(ids.size() == 1, "exit: child");
+    if (ids.size() == 1)
+        verify(path, "exit", 5 * B, ids[0], 5 * B);
+
+    // Gdy pliku nie da się powiększyć, dopisywanie nie zgłasza wyjątku,
+    // a błąd zgłasza sync().
+    ids = crash(path, [](Ledger &ledger) {
+        std::signal(SIGXFSZ, SIG_IGN);
+        struct rlimit limit = {1 << 20, 1 << 20};
+        setrlimit(RLIMIT_FSIZE, &limit);
+        Wallet a(1), b;
+        for (int i = 0; i < 50000; ++i)
+            a -= b;
+        Wallet m(std::move(a), std::move(b));
+        bool thrown = false;
+        try {
+            ledger.sync();
+        } catch (const std::system_error &) {
+            thrown = true;
+        }
+        crashNow({!ledger.good() && thrown});
+    });
+    check(ids.size() == 1 && ids[0] == 1, "disk full");
+
+    std::remove(path.c_str());
+    if (failures == 0)
+        std::cout << "OK\n";
+    return failures == 0 ? 0 : 1;
+}
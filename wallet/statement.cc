@@ -0,0 +1,152 @@
+#include <charconv>
+#include <ctime>
+#include <ios>
+#include <string>
+#include "statement.h"
+
+
+// Rozmiar bufora, po którego zapełnieniu dane trafiają do strumienia.
+static const size_t bufferSize = 1 << 20;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Bufor wyjściowy
+
+
+namespace {
+
+// Gromadzi dane w dużym buforze, by ograniczyć liczbę wywołań os.write().
+class StatementBuffer {
+
+    std::ostream &os;
+    std::string buffer;
+
+public:
+
+    explicit StatementBuffer(std::ostream &os) : os(os) {
+        buffer.reserve(bufferSize);
+    }
+
+    void flush() {
+        if (!buffer.empty()) {
+            os.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+    }
+
+    void append(const char *data, size_t size) {
+        buffer.append(data, size);
+        if (buffer.size() >= bufferSize)
+            flush();
+    }
+
+    void append(char c) {
+        buffer.push_back(c);
+    }
+
+    template<typename Int>
+    void appendNumber(Int n) {
+        char tmp[24];
+        auto result = std::to_chars(tmp, tmp + sizeof(tmp), n);
+        append(tmp, static_cast<size_t>(result.ptr - tmp));
+    }
+
+    void appendLittleEndian(uint64_t n) {
+        char tmp[8];
+        for (char &c : tmp) {
+            c = static_cast<char>(n & 0xff);
+            n >>= 8;
+        }
+        append(tmp, sizeof(tmp));
+    }
+
+};
+
+// Zapamiętuje ostatnio sformatowany dzień, by wywoływać localtime_r() raz
+// na dzień, a nie raz na operację.
+class DayCache {
+
+    time_t dayBegin = 1;
+    time_t dayEnd = 0;
+    char text[16];
+
+public:
+
+    const char *format(time_t t) {
+        if (t < dayBegin || t >= dayEnd) {
+            struct tm day;
+            localtime_r(&t, &day);
+            strftime(text, sizeof(text), "%Y-%m-%d", &day);
+
+            day.tm_hour = day.tm_min = day.tm_sec = 0;
+            day.tm_isdst = -1;
+            dayBegin = mktime(&day);
+            ++day.tm_mday;
+            day.tm_isdst = -1;
+            dayEnd = mktime(&day);
+        }
+        return text;
+    }
+
+};
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Wypisywanie historii
+
+
+static void writeHistory(StatementBuffer &out, DayCache &days, uint64_t walletNumber,
+                         const Wallet &w, StatementFormat format) {
+    using namespace std::chrono;
+    size_t size = w.opSize();
+    for (size_t i = 0; i < size; ++i) {
+        const Operation &o = w[i];
+        int64_t ms = duration_cast<milliseconds>(o.getTimestamp().time_since_epoch()).count();
+
+        if (format == StatementFormat::Binary) {
+            out.appendLittleEndian(walletNumber);
+            out.appendLittleEndian(static_cast<uint64_t>(ms));
+            out.appendLittleEndian(o.getUnits());
+        } else {
+            out.appendNumber(walletNumber);
+            out.append(',');
+            out.appendNumber(i);
+            out.append(',');
+            out.appendNumber(ms);
+            out.append(',');
+            out.append(days.format(system_clock::to_time_t(o.getTimestamp())), 10);
+            out.append(',');
+            out.appendNumber(o.getUnits());
+            out.append('\n');
+        }
+    }
+}
+
+void writeStatement(std::ostream &os, const std::vector<const Wallet *> &wallets,
+                    StatementFormat format) {
+    static const char header[] = "wallet,operation,timestamp_ms,date,units\n";
+
+    StatementBuffer out(os);
+    DayCache days;
+    if (format == StatementFormat::CSV)
+        out.append(header, sizeof(header) - 1);
+    for (size_t i = 0; i < wallets.size(); ++i) {
+        writeHistory(out, days, i, *wallets[i], format);
+    }
+    out.flush();
+    if (!os)
+        throw std::ios_base::failure("Failed to write wallet statement");
+}
+
+void writeStatement(std::ostream &os, const Wallet &w, StatementFormat format) {
+    writeStatement(os, std::vector<const Wallet *>{&w}, format);
+}
+
+std::future<void> writeStatementAsync(std::ostream &os, std::vector<const Wallet *> wallets,
+                                      StatementFormat format) {
+    return std::async(std::launch::async, [&os, wallets = std::move(wallets), format] {
+        writeStatement(os, wallets, format);
+    });
+}
@@ -0,0 +1,41 @@
+#ifndef STATEMENT_H
+#define STATEMENT_H
+
+
+#include <future>
+#include <ostream>
+#include <vector>
+#include "wallet.h"
+
+
+// Format wyciągu z historii portfeli.
+//
+// CSV: nagłówek "wallet,operation,timestamp_ms,date,units", a następnie jeden
+// wiersz na każdą operację. Data w formacie yyyy-mm-dd (czas lokalny, jak przy
+// wypisywaniu Operation), units to stan portfela po operacji w jednostkach
+// (1 B = 100 000 000 jednostek).
+//
+// Binary: bez nagłówka, jeden 24-bajtowy rekord na operację, złożony z trzech
+// 64-bitowych liczb w kolejności cienkokońcówkowej (ang. little endian):
+// numer portfela, czas w milisekundach od epoki (ze znakiem), units.
+enum class StatementFormat {
+    CSV,
+    Binary
+};
+
+// Wypisuje na strumień os pełną historię portfela w jako portfela numer 0.
+void writeStatement(std::ostream &os, const Wallet &w, StatementFormat format);
+
+// Wypisuje na strumień os pełne historie portfeli z wallets. Numerem portfela
+// jest jego indeks w wallets.
+void writeStatement(std::ostream &os, const std::vector<const Wallet *> &wallets,
+                    StatementFormat format);
+
+// Jak wyżej, ale wypisywanie odbywa się w osobnym wątku. Do czasu zakończenia
+// zwróconego zadania nie wolno modyfikować portfeli z wallets ani używać
+// strumienia os. Błędy zapisu są zgłaszane przy wywołaniu get().
+std::future<void> writeStatementAsync(std::ostream &os, std::vector<const Wallet *> wallets,
+                                      StatementFormat format);
+
+
+#endif // STATEMENT_H
@@ -1,16 +1,33 @@
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <iomanip>
 #include <stdexcept>
 #include <limits>
 #include <cassert>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include "ledger.h"
 #include "wallet.h"
 
 
 static uint64_t globalUnits = 0;
 
-static const uint64_t decimal_shift = 100'000'000;
-static const uint64_t maxBC = 21'000'000;
+// Podłączony dziennik operacji.
+static Ledger *ledger = nullptr;
+// Pierwszy identyfikator portfela utworzonego po podłączeniu dziennika.
+static uint64_t sessionFirstId = 1;
+static uint64_t nextWalletId = 1;
+// Portfele odtworzone z dziennika.
+static std::unordered_set<uint64_t> reopened;
+
+// Zasada przechowywania historii portfeli.
+static RetentionPolicy retention;
+
+static const uint64_t decimal_shift = jnp_wallet_::decimalShift;
+static const uint64_t maxBC = jnp_wallet_::maxBC;
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -48,20 +65,112 @@ static void writeCurrency(std::ostream &os, uint64_t amount) {
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+// Zgrubny zegar
+
+
+// Czas w milisekundach od epoki, uaktualniany przez wątek CoarseTicker.
+static std::atomic<int64_t> coarseNow(0);
+static std::atomic<bool> coarseEnabled(false);
+
+static int64_t systemMillis() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+namespace {
+
+// Wątek uaktualniający coarseNow kilka razy na milisekundę. Zapisuje tylko
+// wartości nie mniejsze od poprzednich, więc zegar nie cofa się nawet przy
+// korekcie zegara systemowego.
+class CoarseTicker {
+
+    std::mutex mutex;
+    std::thread thread;
+    std::atomic<bool> stopping{false};
+
+    void run() {
+        while (!stopping.load(std::memory_order_relaxed)) {
+            int64_t now = systemMillis();
+            if (now > coarseNow.load(std::memory_order_relaxed))
+                coarseNow.store(now, std::memory_order_relaxed);
+            std::this_thread::sleep_for(std::chrono::microseconds(250));
+        }
+    }
+
+public:
+
+    void start() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (thread.joinable())
+            return;
+        int64_t now = systemMillis();
+        if (now > coarseNow.load())
+            coarseNow.store(now);
+        stopping = false;
+        thread = std::thread(&CoarseTicker::run, this);
+    }
+
+    void stop() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!thread.joinable())
+            return;
+        stopping = true;
+        thread.join();
+    }
+
+    // Portfele niszczone po tym obiekcie (np. statyczne) wracają do
+    // system_clock.
+    ~CoarseTicker() {
+        coarseEnabled = false;
+        stop();
+    }
+
+};
+
+CoarseTicker &coarseTicker() {
+    static CoarseTicker ticker;
+    return ticker;
+}
+
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // Operation
 
 
 Operation::Operation(uint64_t units) : units(units) {
     using namespace std::chrono;
-    timestamp = time_point_cast<milliseconds>(system_clock::now());
+    if (coarseEnabled.load(std::memory_order_relaxed))
+        timestamp = system_clock::time_point(milliseconds(coarseNow.load(std::memory_order_relaxed)));
+    else
+        timestamp = time_point_cast<milliseconds>(system_clock::now());
 }
 
+void Operation::useCoarseClock(bool enabled) {
+    if (enabled) {
+        coarseTicker().start();
+        coarseEnabled = true;
+    } else {
+        coarseEnabled = false;
+        coarseTicker().stop();
+    }
+}
+
+Operation::Operation(uint64_t units, std::chrono::system_clock::time_point timestamp)
+        : units(units), timestamp(timestamp) {}
+
 // Zwraca liczbę jednostek w portfelu po operacji.
 uint64_t Operation::getUnits() const {
     return units;
 }
 
+// Zwraca czas wykonania operacji (z dokładnością do milisekund).
+std::chrono::system_clock::time_point Operation::getTimestamp() const {
+    return timestamp;
+}
+
 // Operatory porównujące czas utworzenia (z dokładnością do milisekund)
 // operacji o1 i o2.
 bool Operation::operator<(const Operation &o) const {
@@ -101,93 +210,6 @@ std::ostream &operator<<(std::ostream &os, const Operation &o) {
 }
 
 
-////////////////////////////////////////////////////////////////////////////////
-// Parsowanie liczb
-
-
-static uint64_t parseString(const char *str) {
-    assert(str != nullptr);
-    const char *p = str;
-    uint64_t ans = 0;
-
-    while (isspace(*p)) ++p; // Ignorujemy wiodące białe znaki.
-    if (*p == '\0') // Były tylko białe znaki.
-        throw std::invalid_argument("Whitespace-only B number string.");
-    bool leadingDigits = isdigit(*p); // Czy przed separatorem są cyfry?
-    bool trailingDigits = true;
-
-    // Część całkowita.
-    while (isdigit(*p)) {
-        ans *= 10;
-        ans += *p - '0';
-        // Liczby większe od maxBC uznajemy w tej fazie za poprawne argumenty.
-        // Utożsamiamy je jednak z maxBC + 1, by zapobiec przepełnieniu zmiennej.
-        if (ans > maxBC)
-            ans = maxBC + 1;
-        ++p;
-    }
-
-    // Część ułamkowa.
-    if (*p == ',' || *p == '.') {
-        ++p;
-        trailingDigits = isdigit(*p); // Czy po separatorze są cyfry?
-
-        unsigned currentShift = 1;
-        while (currentShift < decimal_shift && isdigit(*p)) {
-            ans *= 10;
-            ans += *p - '0';
-            currentShift *= 10;
-            ++p;
-        }
-
-        // Uzupełniamy do 8 miejsc po przecinku.
-        while (currentShift < decimal_shift) {
-            ans *= 10;
-            currentShift *= 10;
-        }
-
-        // Zezwalamy na dowolną liczbę zer kończących.
-        while (*p == '0') ++p;
-
-    } else {
-        // Brak części ułamkowej.
-        ans *= decimal_shift;
-    }
-
-    while (isspace(*p)) ++p; // Ignorujemy kończące białe znaki.
-
-    if (*p != '\0')
-        throw std::invalid_argument("Invalid B number string.");
-    if (!leadingDigits && !trailingDigits)
-        throw std::invalid_argument("\".\" is not a valid representation of 0 B.");
-
-    return ans;
-}
-
-static uint64_t parseBinaryString(const char *str) {
-    assert(str != nullptr);
-    const char *p = str;
-    uint64_t ans = 0;
-    if (*p == '\0') // Były tylko białe znaki.
-        throw std::invalid_argument("Invalid BC input string format");
-
-    while (*p == '0' || *p == '1') {
-        ans *= 2;
-        ans += (*p == '1');
-        // Liczby większe od maxBC uznajemy w tej fazie za poprawne argumenty.
-        // Utożsamiamy je jednak z maxBC + 1, by zapobiec przepełnieniu zmiennej.
-        if (ans > maxBC)
-            ans = maxBC + 1;
-        ++p;
-    }
-
-    if (*p != '\0')
-        throw std::invalid_argument("Invalid BC input string format");
-
-    return ans * decimal_shift;
-}
-
-
 ////////////////////////////////////////////////////////////////////////////////
 // Podstawowe operacje na portfelach
 
@@ -206,12 +228,28 @@ static void destroyUnits(uint64_t units) {
 // Procedura używana po przeniesieniu portfela.
 void Wallet::reset() {
     history.clear();
+    timeIndex.clear();
+    checkpoint = Operation(0, std::chrono::system_clock::time_point::min());
+    id = newId();
     updateHistory(0);
 }
 
-// Dodaje nowy stan portfela do historii
+// Dopisuje stan portfela id do podłączonego dziennika.
+static void appendToLedger(uint64_t id, std::chrono::system_clock::time_point timestamp,
+                           uint64_t units) {
+    using namespace std::chrono;
+    if (ledger != nullptr) {
+        auto ms = duration_cast<milliseconds>(timestamp.time_since_epoch());
+        ledger->append(id, ms.count(), units);
+    }
+}
+
+// Dodaje nowy stan portfela do historii i do podłączonego dziennika.
 void Wallet::updateHistory(uint64_t units) {
     history.push_back(Operation(units));
+    if (timeIndexStride != 0 && (history.size() - 1) % timeIndexStride == 0)
+        timeIndex.push_back(history.back().timestamp);
+    appendToLedger(id, history.back().timestamp, units);
 }
 
 uint64_t Wallet::takeAllUnits() {
@@ -280,7 +318,9 @@ Wallet::Wallet() : Wallet(0ul) {}
 // oddzielona przecinkiem lub kropką. Białe znaki na początku i końcu napisu
 // powinny być ignorowane. Historia portfela ma jeden wpis.
 Wallet::Wallet(const char *str) {
-    init(::parseString(str));
+    if (str == nullptr)
+        throw std::invalid_argument("Null B number string.");
+    init(jnp_wallet_::parseString(str));
 }
 Wallet::Wallet(const std::string &str) : Wallet(str.c_str()) {}
 
@@ -293,7 +333,10 @@ Wallet::Wallet(const std::string &str) : Wallet(str.c_str()) {}
 //
 // Użycie w operator+ zwykłego konstruktora przenoszącego skutkowałoby
 // trzema wpisami w historii.
-Wallet::Wallet(Wallet &&w2, bool) noexcept : history(std::move(w2.history)) {
+Wallet::Wallet(Wallet &&w2, bool) noexcept
+        : history(std::move(w2.history)), id(w2.id),
+          timeIndexStride(w2.timeIndexStride), timeIndex(std::move(w2.timeIndex)),
+          checkpoint(w2.checkpoint) {
     w2.reset();
 }
 // Nakładka na pomocniczy konstruktor przenoszący, ukrywająca jego wymuszony,
@@ -307,25 +350,73 @@ Wallet::Wallet(Wallet &&w2) noexcept : Wallet(std::move(w2), true) {
     updateHistory(getUnits());
 }
 
+// Scala historie h1 i h2 tak jak std::merge (przy równych czasach wpisy z h1
+// są wcześniej), rezerwując od razu miejsce na jeden dodatkowy wpis. Wynik
+// powstaje w buforze jednej z historii, który jest przejmowany. Jeżeli
+// historie nie przeplatają się w czasie, druga jest dopisywana jednym
+// kopiowaniem bloku, bez porównywania wpisów.
+static OperationHistory mergeHistories(OperationHistory &h1, OperationHistory &h2) {
+    size_t size = h1.size() + h2.size() + 1;
+
+    if (h1.empty() || h2.empty() || h1.back() <= h2.front()) {
+        OperationHistory ans = std::move(h1);
+        ans.reserve(size);
+        ans.insert(ans.end(), h2.begin(), h2.end());
+        return ans;
+    }
+    if (h2.back() < h1.front()) {
+        OperationHistory ans = std::move(h2);
+        ans.reserve(size);
+        ans.insert(ans.end(), h1.begin(), h1.end());
+        return ans;
+    }
+
+    // Przejmujemy bufor, który już mieści wynik, a jeśli żaden nie mieści,
+    // to bufor h1. Drugą historię dopisujemy na koniec, po czym scalamy od
+    // końca, nadpisując miejsca zajęte już wcześniej przeniesionymi wpisami.
+    bool firstIsDst = h1.capacity() >= size || h2.capacity() < size;
+    OperationHistory ans = std::move(firstIsDst ? h1 : h2);
+    const OperationHistory &src = firstIsDst ? h2 : h1;
+    size_t i = ans.size();
+    size_t j = src.size();
+    ans.reserve(size);
+    ans.insert(ans.end(), src.begin(), src.end());
+
+    size_t k = i + j;
+    while (j > 0) {
+        bool takeDst = i > 0 &&
+                (firstIsDst ? src[j - 1] < ans[i - 1] : !(ans[i - 1] < src[j - 1]));
+        ans[--k] = takeDst ? ans[--i] : src[--j];
+    }
+    return ans;
+}
+
 // Tworzy portfel, którego historia operacji to suma historii operacji w1
 // i w2 plus jeden wpis, całość uporządkowana wg czasów wpisów. Po operacji
 // w w0 jest w1.getUnits() + w2.getUnits() jednostek, a portfele w1 i w2 są
-// puste.
+// puste. Portfel, którego bufora historii nie przejęto, zachowuje go
+// po wyczyszczeniu.
 Wallet::Wallet(Wallet &&w1, Wallet &&w2) noexcept {
     uint64_t sum = w1.getUnits() + w2.getUnits();
-    std::merge(
-            std::make_move_iterator(w1.history.begin()),
-            std::make_move_iterator(w1.history.end()),
-            std::make_move_iterator(w2.history.begin()),
-            std::make_move_iterator(w2.history.end()),
-            std::back_inserter(history));
+    // Scalona historia nie odpowiada na pytania o chwile sprzed późniejszego
+    // z punktów kontrolnych.
+    checkpoint = w1.checkpoint < w2.checkpoint ? w2.checkpoint : w1.checkpoint;
+    history = mergeHistories(w1.history, w2.history);
     updateHistory(sum);
+    // Identyfikatory w1 i w2 nie przechodzą na nowy portfel, więc zamykamy
+    // je w dzienniku stanem 0, by po odtworzeniu dziennika ich jednostki nie
+    // zostały policzone drugi raz.
+    appendToLedger(w1.id, history.back().timestamp, 0);
+    appendToLedger(w2.id, history.back().timestamp, 0);
     w2.reset();
     w1.reset();
 }
 
+// Jednostki portfela znikają z globalnej puli, ale dziennik nie dostaje
+// wpisu zamykającego, więc ostatni stan portfela można odtworzyć po ponownym
+// uruchomieniu programu (zob. attachLedger).
 Wallet::~Wallet() {
-    takeAllUnits();
+    destroyUnits(getUnits());
 }
 
 // Pomocniczy konstruktor. Używany wyłącznie w Wallet::construct().
@@ -343,7 +434,9 @@ Wallet Wallet::construct(uint64_t units) {
 // ilości B w systemie binarnym. Kolejność bajtów jest grubokońcówkowa
 // (ang. big endian).
 Wallet Wallet::fromBinary(const char *str) {
-    return construct(::parseBinaryString(str));
+    if (str == nullptr)
+        throw std::invalid_argument("Invalid BC input string format");
+    return construct(jnp_wallet_::parseBinaryString(str));
 }
 
 // Przypisanie. Jeżeli oba obiekty są tym samym obiektem, to nic nie robi, wpp.
@@ -352,12 +445,181 @@ Wallet &&Wallet::operator=(Wallet &&w) noexcept {
     if (&w == this) return std::move(*this);
     takeAllUnits();
     history = std::move(w.history);
+    id = w.id;
+    timeIndexStride = w.timeIndexStride;
+    timeIndex = std::move(w.timeIndex);
+    checkpoint = w.checkpoint;
     updateHistory(getUnits());
     w.reset();
     return std::move(*this);
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+// Dziennik
+
+
+uint64_t Wallet::newId() {
+    return nextWalletId++;
+}
+
+// Zwraca identyfikator portfela w dzienniku.
+uint64_t Wallet::getId() const {
+    return id;
+}
+
+// Pomocniczy konstruktor. Używany wyłącznie w Wallet::reopen(). Jednostki
+// odtwarzanego portfela są już w globalnej puli, więc ich nie tworzy, a stanu
+// nie dopisuje ponownie do dziennika.
+Wallet::Wallet(uint64_t id, uint64_t units, std::chrono::system_clock::time_point timestamp)
+        : id(id) {
+    history.push_back(Operation(units, timestamp));
+}
+
+void Wallet::attachLedger(Ledger &l) {
+    if (ledger != nullptr)
+        throw std::logic_error("Ledger already attached");
+    createNewUnits(l.liveUnits());
+    ledger = &l;
+    nextWalletId = std::max(nextWalletId, l.nextWalletId());
+    sessionFirstId = nextWalletId;
+    reopened.clear();
+}
+
+void Wallet::detachLedger(Ledger &l) {
+    if (ledger == &l)
+        ledger = nullptr;
+}
+
+Wallet Wallet::reopen(uint64_t id) {
+    using namespace std::chrono;
+    if (ledger == nullptr)
+        throw std::logic_error("No ledger attached");
+    uint64_t last = ledger->last(id);
+    if (last == Ledger::noRecord)
+        throw std::invalid_argument("No such wallet in the ledger");
+    if (id >= sessionFirstId || !reopened.insert(id).second)
+        throw std::logic_error("Wallet is already open");
+
+    const LedgerRecord &r = (*ledger)[last];
+    return Wallet(id, r.units, system_clock::time_point(milliseconds(r.timestamp)));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Paczki przelewów
+
+
+// Zwiększa acc o units, zgłaszając błąd przy przepełnieniu. Sumy wpływów
+// i wypływów mogą przekraczać limit BC, bo przelewy w paczce się znoszą.
+static void addChecked(uint64_t &acc, uint64_t units) {
+    if (acc + units < acc)
+        throw std::logic_error("BC limit exceeded");
+    acc += units;
+}
+
+void Wallet::transfer(const std::vector<Transfer> &batch) {
+    struct Balance {
+        Wallet *wallet;
+        uint64_t credit;
+        uint64_t debit;
+    };
+
+    // Sumujemy wpływy i wypływy każdego portfela w kolejności pierwszego
+    // wystąpienia w paczce.
+    std::vector<Balance> balances;
+    std::unordered_map<Wallet *, size_t> index;
+    auto balanceOf = [&](Wallet *w) -> Balance & {
+        auto it = index.emplace(w, balances.size());
+        if (it.second)
+            balances.push_back(Balance{w, 0, 0});
+        return balances[it.first->second];
+    };
+
+    for (const Transfer &t : batch) {
+        if (t.source == nullptr || t.destination == nullptr)
+            throw std::invalid_argument("Transfer to or from a null wallet");
+        if (t.source == t.destination)
+            continue;
+        addChecked(balanceOf(t.source).debit, t.units);
+        addChecked(balanceOf(t.destination).credit, t.units);
+    }
+
+    // Sprawdzamy tylko stany końcowe. Przelewy nie zmieniają globalnej liczby
+    // jednostek, więc żaden stan końcowy nie przekroczy limitu BC.
+    for (const Balance &b : balances) {
+        uint64_t units = b.wallet->getUnits();
+        addChecked(units, b.credit);
+        if (units < b.debit)
+            throw std::logic_error("Insufficient BC for substraction");
+    }
+
+    for (const Balance &b : balances) {
+        b.wallet->updateHistory(b.wallet->getUnits() + b.credit - b.debit);
+    }
+}
+
+void Wallet::transfer(const std::vector<std::vector<Transfer>> &batches) {
+    // Łączymy paczki mające wspólne portfele w grupy (find-union).
+    std::vector<size_t> parent(batches.size());
+    for (size_t i = 0; i < parent.size(); ++i)
+        parent[i] = i;
+    auto find = [&](size_t i) {
+        while (parent[i] != i)
+            i = parent[i] = parent[parent[i]];
+        return i;
+    };
+
+    std::unordered_map<Wallet *, size_t> owner;
+    for (size_t i = 0; i < batches.size(); ++i) {
+        for (const Transfer &t : batches[i]) {
+            for (Wallet *w : {t.source, t.destination}) {
+                auto it = owner.emplace(w, i);
+                if (!it.second)
+                    parent[find(i)] = find(it.first->second);
+            }
+        }
+    }
+
+    std::unordered_map<size_t, size_t> groupIndex;
+    std::vector<std::vector<size_t>> groups;
+    for (size_t i = 0; i < batches.size(); ++i) {
+        auto it = groupIndex.emplace(find(i), groups.size());
+        if (it.second)
+            groups.emplace_back();
+        groups[it.first->second].push_back(i);
+    }
+
+    std::vector<std::exception_ptr> errors(batches.size());
+    std::atomic<size_t> nextGroup(0);
+    auto worker = [&] {
+        for (size_t g; (g = nextGroup++) < groups.size();) {
+            for (size_t i : groups[g]) {
+                try {
+                    transfer(batches[i]);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            }
+        }
+    };
+
+    size_t threadCount = std::min<size_t>(groups.size(),
+                                          std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread &t : threads)
+        t.join();
+
+    for (const std::exception_ptr &e : errors) {
+        if (e)
+            std::rethrow_exception(e);
+    }
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // Operatory arytmetyczne i porównujące dla Wallet
 
@@ -440,6 +702,176 @@ bool operator>=(const Wallet &w1, const Wallet &w2) {
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+// Wyszukiwanie w historii według czasu
+
+
+OperationRange::OperationRange(const Operation *first, const Operation *last)
+        : first(first), last(last) {}
+
+const Operation *OperationRange::begin() const {
+    return first;
+}
+
+const Operation *OperationRange::end() const {
+    return last;
+}
+
+size_t OperationRange::size() const {
+    return static_cast<size_t>(last - first);
+}
+
+bool OperationRange::empty() const {
+    return first == last;
+}
+
+const Operation &OperationRange::operator[](size_t k) const {
+    return first[k];
+}
+
+void Wallet::rebuildTimeIndex() {
+    timeIndex.clear();
+    if (timeIndexStride == 0)
+        return;
+    for (size_t i = 0; i < history.size(); i += timeIndexStride)
+        timeIndex.push_back(history[i].timestamp);
+}
+
+void Wallet::enableTimeIndex(size_t stride) {
+    timeIndexStride = stride;
+    rebuildTimeIndex();
+    timeIndex.shrink_to_fit();
+}
+
+// Zwraca indeks pierwszej operacji wykonanej nie wcześniej niż t, albo
+// opSize(), jeśli takiej nie ma.
+size_t Wallet::lowerBound(std::chrono::system_clock::time_point t) const {
+    auto first = history.begin();
+    auto last = history.end();
+
+    // Indeks zawęża wyszukiwanie do fragmentu między dwoma kolejnymi
+    // zapamiętanymi czasami.
+    if (timeIndexStride != 0) {
+        size_t block = static_cast<size_t>(
+                std::lower_bound(timeIndex.begin(), timeIndex.end(), t) - timeIndex.begin());
+        if (block > 0)
+            first += (block - 1) * timeIndexStride + 1;
+        if (block < timeIndex.size())
+            last = history.begin() + block * timeIndexStride;
+    }
+
+    auto it = std::lower_bound(first, last, t, [](const Operation &o, const auto &time) {
+        return o.timestamp < time;
+    });
+    return static_cast<size_t>(it - history.begin());
+}
+
+// Zwraca liczbę jednostek w portfelu w chwili t.
+uint64_t Wallet::balanceAt(std::chrono::system_clock::time_point t) const {
+    using namespace std::chrono;
+    // Czasy operacji są zaokrąglone do milisekund.
+    size_t k = lowerBound(time_point_cast<milliseconds>(t) + milliseconds(1));
+    if (k > 0)
+        return history[k - 1].getUnits();
+    if (time_point_cast<milliseconds>(t) < checkpoint.timestamp)
+        throw std::out_of_range("Balance before the retained history is unknown");
+    return checkpoint.getUnits();
+}
+
+// Zwraca operacje wykonane w przedziale czasu [a, b).
+OperationRange Wallet::operationsBetween(std::chrono::system_clock::time_point a,
+                                         std::chrono::system_clock::time_point b) const {
+    size_t first = lowerBound(a);
+    size_t last = std::max(first, lowerBound(b));
+    return OperationRange(history.data() + first, history.data() + last);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Przechowywanie historii
+
+
+RetentionPolicy RetentionPolicy::keepAll() {
+    return RetentionPolicy();
+}
+
+RetentionPolicy RetentionPolicy::keepLast(size_t count) {
+    RetentionPolicy ans;
+    ans.kind = KeepLast;
+    ans.count = count;
+    return ans;
+}
+
+RetentionPolicy RetentionPolicy::keepNewerThan(std::chrono::milliseconds age) {
+    RetentionPolicy ans;
+    ans.kind = KeepNewerThan;
+    ans.age = age;
+    return ans;
+}
+
+RetentionPolicy RetentionPolicy::dailyCheckpoints(std::chrono::milliseconds age) {
+    RetentionPolicy ans;
+    ans.kind = DailyCheckpoints;
+    ans.age = age;
+    return ans;
+}
+
+void Wallet::setRetentionPolicy(const RetentionPolicy &policy) {
+    retention = policy;
+}
+
+// Porządkuje historię portfela zgodnie z zasadą przechowywania. Usuwane są
+// zawsze wpisy z początku historii, więc zachowana część pozostaje
+// uporządkowana chronologicznie, a ostatni wpis (stan portfela) nie ginie.
+// Wpis bezpośrednio poprzedzający zachowaną część staje się punktem
+// kontrolnym dla balanceAt().
+void Wallet::compact() {
+    using namespace std::chrono;
+    auto cutoff = system_clock::now() - retention.age;
+    size_t old = lowerBound(cutoff);
+
+    switch (retention.kind) {
+    case RetentionPolicy::KeepAll:
+        break;
+    case RetentionPolicy::KeepLast: {
+        size_t keep = std::max<size_t>(retention.count, 1);
+        if (history.size() > keep) {
+            checkpoint = history[history.size() - keep - 1];
+            history.erase(history.begin(), history.end() - keep);
+        }
+        break;
+    }
+    case RetentionPolicy::KeepNewerThan: {
+        size_t removed = std::min(old, history.size() - 1);
+        if (removed > 0) {
+            checkpoint = history[removed - 1];
+            history.erase(history.begin(), history.begin() + removed);
+        }
+        break;
+    }
+    case RetentionPolicy::DailyCheckpoints: {
+        // Wpis z okresu [0, old) zostaje, jeśli jest ostatnim wpisem swojej
+        // doby albo ostatnim wpisem tego okresu.
+        auto day = [](const Operation &o) {
+            return duration_cast<hours>(o.timestamp.time_since_epoch()).count() / 24;
+        };
+        size_t kept = 0;
+        for (size_t i = 0; i < old; ++i) {
+            if (i + 1 == old || day(history[i]) != day(history[i + 1])) {
+                if (kept == 0 && i > 0)
+                    checkpoint = history[i - 1];
+                history[kept++] = history[i];
+            }
+        }
+        history.erase(history.begin() + kept, history.begin() + old);
+        break;
+    }
+    }
+
+    rebuildTimeIndex();
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // Pozostałe
 
@@ -449,6 +881,12 @@ uint64_t Wallet::opSize() const {
     return history.size();
 }
 
+// Zwraca liczbę bajtów zajmowanych przez historię portfela.
+size_t Wallet::historyBytes() const {
+    return history.capacity() * sizeof(Operation) +
+           timeIndex.capacity() * sizeof(timeIndex[0]);
+}
+
 // Zwraca k-tą operację na portfelu. Pod indeksem 0 powinna być najstarsza
 // operacja. Przypisanie do w[k] powinno być zabronione na etapie kompilacji.
 const Operation &Wallet::operator[](size_t k) const {
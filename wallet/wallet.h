@@ -3,9 +3,127 @@
 
 
 #include <chrono>
+#include <cstdint>
 #include <ostream>
+#include <stdexcept>
 #include <string>
 #include <vector>
+#include "historypool.h"
+
+
+// Parsowanie liczb. Funkcje są constexpr, by literały portfeli (zob. _B
+// i _Bbin) były sprawdzane i zamieniane na jednostki w czasie kompilacji.
+namespace jnp_wallet_ {
+
+    // Liczba jednostek w 1 B.
+    constexpr uint64_t decimalShift = 100'000'000;
+    // Maksymalna liczba B we wszystkich portfelach.
+    constexpr uint64_t maxBC = 21'000'000;
+
+    constexpr bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+    }
+
+    constexpr bool isDigit(char c) {
+        return '0' <= c && c <= '9';
+    }
+
+    // Parsery nie porównują str z nullptr: przy -fsanitize=undefined takie
+    // porównanie adresu nie jest wyrażeniem stałym i literały przestałyby się
+    // kompilować. Wskaźnik sprawdzają konstruktory przyjmujące napisy.
+    constexpr uint64_t parseString(const char *str) {
+        const char *p = str;
+        uint64_t ans = 0;
+
+        while (isSpace(*p)) ++p; // Ignorujemy wiodące białe znaki.
+        if (*p == '\0') // Były tylko białe znaki.
+            throw std::invalid_argument("Whitespace-only B number string.");
+        bool leadingDigits = isDigit(*p); // Czy przed separatorem są cyfry?
+        bool trailingDigits = true;
+
+        // Część całkowita.
+        while (isDigit(*p)) {
+            ans *= 10;
+            ans += *p - '0';
+            // Liczby większe od maxBC uznajemy w tej fazie za poprawne argumenty.
+            // Utożsamiamy je jednak z maxBC + 1, by zapobiec przepełnieniu zmiennej.
+            if (ans > maxBC)
+                ans = maxBC + 1;
+            ++p;
+        }
+
+        // Część ułamkowa.
+        if (*p == ',' || *p == '.') {
+            ++p;
+            trailingDigits = isDigit(*p); // Czy po separatorze są cyfry?
+
+            uint64_t currentShift = 1;
+            while (currentShift < decimalShift && isDigit(*p)) {
+                ans *= 10;
+                ans += *p - '0';
+                currentShift *= 10;
+                ++p;
+            }
+
+            // Uzupełniamy do 8 miejsc po przecinku.
+            while (currentShift < decimalShift) {
+                ans *= 10;
+                currentShift *= 10;
+            }
+
+            // Zezwalamy na dowolną liczbę zer kończących.
+            while (*p == '0') ++p;
+
+        } else {
+            // Brak części ułamkowej.
+            ans *= decimalShift;
+        }
+
+        while (isSpace(*p)) ++p; // Ignorujemy kończące białe znaki.
+
+        if (*p != '\0')
+            throw std::invalid_argument("Invalid B number string.");
+        if (!leadingDigits && !trailingDigits)
+            throw std::invalid_argument("\".\" is not a valid representation of 0 B.");
+
+        return ans;
+    }
+
+    constexpr uint64_t parseBinaryString(const char *str) {
+        const char *p = str;
+        uint64_t ans = 0;
+        if (*p == '\0') // Były tylko białe znaki.
+            throw std::invalid_argument("Invalid BC input string format");
+
+        while (*p == '0' || *p == '1') {
+            ans *= 2;
+            ans += (*p == '1');
+            // Liczby większe od maxBC uznajemy w tej fazie za poprawne argumenty.
+            // Utożsamiamy je jednak z maxBC + 1, by zapobiec przepełnieniu zmiennej.
+            if (ans > maxBC)
+                ans = maxBC + 1;
+            ++p;
+        }
+
+        if (*p != '\0')
+            throw std::invalid_argument("Invalid BC input string format");
+
+        return ans * decimalShift;
+    }
+}
+
+
+class Ledger;
+class Wallet;
+
+
+// Przelew units jednostek (1 B = 100 000 000 jednostek) z portfela source do
+// portfela destination, wykonywany w paczce przez Wallet::transfer.
+struct Transfer {
+    Wallet *source;
+    Wallet *destination;
+    uint64_t units;
+};
 
 
 class Operation {
@@ -19,11 +137,24 @@ class Operation {
 
     Operation(uint64_t units);
 
+    Operation(uint64_t units, std::chrono::system_clock::time_point timestamp);
+
 public:
 
     // Zwraca liczbę jednostek w portfelu po operacji.
     uint64_t getUnits() const;
 
+    // Zwraca czas wykonania operacji (z dokładnością do milisekund).
+    std::chrono::system_clock::time_point getTimestamp() const;
+
+    // Włącza lub wyłącza zgrubny zegar operacji. Domyślnie czas każdej
+    // operacji jest odczytywany z system_clock. Zgrubny zegar zwraca czas
+    // z dokładnością do milisekund, uaktualniany w tle przez osobny wątek,
+    // więc utworzenie operacji sprowadza się do odczytu jednej zmiennej.
+    // Odczytywany czas nigdy nie maleje, także między wątkami, ale może
+    // spóźniać się o około milisekundę.
+    static void useCoarseClock(bool enabled);
+
     // Operatory porównujące czas utworzenia (z dokładnością do milisekund)
     // operacji o1 i o2, gdzie op to jeden z: ==, <, <=, != , >, >=.
     bool operator<(const Operation &o) const;
@@ -42,10 +173,83 @@ public:
 std::ostream &operator<<(std::ostream &os, Operation &o);
 
 
+// Historia operacji portfela, przechowywana w buforach z HistoryPool.
+using OperationHistory = std::vector<Operation, HistoryAllocator<Operation>>;
+
+
+// Widok na ciągły fragment historii portfela. Nie jest właścicielem operacji
+// i traci ważność po każdej zmianie historii portfela.
+class OperationRange {
+
+    const Operation *first;
+    const Operation *last;
+
+public:
+
+    OperationRange(const Operation *first, const Operation *last);
+
+    const Operation *begin() const;
+    const Operation *end() const;
+
+    size_t size() const;
+    bool empty() const;
+
+    const Operation &operator[](size_t k) const;
+
+};
+
+
+// Zasada przechowywania historii portfeli (zob. Wallet::setRetentionPolicy).
+struct RetentionPolicy {
+
+    enum Kind {
+        // Zachowuje całą historię.
+        KeepAll,
+        // Zachowuje count ostatnich wpisów. Między kolejnymi porządkowaniami
+        // historia może być dłuższa.
+        KeepLast,
+        // Usuwa wpisy starsze niż age.
+        KeepNewerThan,
+        // Z wpisów starszych niż age zachowuje tylko ostatni wpis każdej doby
+        // (UTC), czyli stan portfela na koniec dnia.
+        DailyCheckpoints
+    };
+
+    Kind kind = KeepAll;
+    size_t count = 0;
+    std::chrono::milliseconds age{0};
+
+    static RetentionPolicy keepAll();
+    static RetentionPolicy keepLast(size_t count);
+    static RetentionPolicy keepNewerThan(std::chrono::milliseconds age);
+    static RetentionPolicy dailyCheckpoints(std::chrono::milliseconds age);
+
+};
+
+
 class Wallet {
 
     // Lista operacji na portfelu, uporządkowana chronologicznie.
-    std::vector<Operation> history;
+    OperationHistory history;
+
+    // Identyfikator portfela w dzienniku (zob. attachLedger). Przechodzi wraz
+    // z historią przy przenoszeniu; portfel opróżniony przez przeniesienie
+    // dostaje nowy identyfikator.
+    uint64_t id = newId();
+
+    // Rzadki indeks czasów: co timeIndexStride-ty czas z historii, zaczynając
+    // od pierwszego. Pusty, gdy timeIndexStride == 0.
+    size_t timeIndexStride = 0;
+    std::vector<std::chrono::system_clock::time_point> timeIndex;
+
+    void rebuildTimeIndex();
+
+    // Ostatni wpis usunięty z historii przez compact(), czyli stan portfela
+    // przed zachowaną częścią historii. Dopóki nic nie usunięto, ma zero
+    // jednostek i najwcześniejszy możliwy czas.
+    Operation checkpoint{0, std::chrono::system_clock::time_point::min()};
+
+    static uint64_t newId();
 
     void updateHistory(uint64_t units);
 
@@ -67,6 +271,8 @@ class Wallet {
 
     Wallet(Wallet &&w, bool) noexcept;
 
+    Wallet(uint64_t id, uint64_t units, std::chrono::system_clock::time_point timestamp);
+
 
 public:
 
@@ -97,6 +303,12 @@ public:
     template<typename T>
     Wallet(T) = delete;
 
+    template<char... cs>
+    friend Wallet operator""_B();
+
+    template<char... cs>
+    friend Wallet operator""_Bbin();
+
     // Konstruktor przenoszący. Historia operacji w1 to historia operacji w2
     // i jeden nowy wpis.
     Wallet(Wallet &&w2) noexcept;
@@ -160,11 +372,89 @@ public:
     // Zwraca liczbę jednostek w portfelu.
     uint64_t getUnits() const;
 
-    // Zwraca liczbę operacji wykonanych na portfelu.
+    // Zwraca identyfikator portfela w dzienniku.
+    uint64_t getId() const;
+
+    // Podłącza dziennik: od tej chwili każdy nowy wpis w historii dowolnego
+    // portfela jest dopisywany do ledger. Zniszczenie portfela nie dopisuje
+    // wpisu, więc w dzienniku zostaje jego ostatni stan, także po zwykłym
+    // zakończeniu programu. Jednostki portfeli zapisanych w dzienniku są
+    // doliczane do globalnej puli, dopóki portfel nie zostanie opróżniony
+    // (np. przez w *= 0 albo przeniesienie jednostek do innego portfela);
+    // portfel, którego jednostki mają przepaść, należy opróżnić przed
+    // zniszczeniem. Dziennik należy podłączyć przed utworzeniem pierwszego
+    // portfela, by identyfikatory się nie powtarzały. Można podłączyć co
+    // najwyżej jeden dziennik.
+    static void attachLedger(Ledger &ledger);
+
+    // Odłącza dziennik ledger, jeżeli jest podłączony.
+    static void detachLedger(Ledger &ledger);
+
+    // Odtwarza portfel o identyfikatorze id z podłączonego dziennika. Historia
+    // zwróconego portfela ma jeden wpis - ostatni stan z dziennika; pełna
+    // historia jest dostępna przez Ledger::history(id). Każdy portfel
+    // zapisany przed podłączeniem dziennika można odtworzyć co najwyżej raz.
+    static Wallet reopen(uint64_t id);
+
+    // Wykonuje paczkę przelewów. Najpierw sprawdza, czy po wykonaniu paczki
+    // żaden portfel nie będzie miał ujemnego stanu ani więcej niż maxBC B, a
+    // następnie dodaje jeden wpis w historii każdego portfela występującego
+    // w paczce. Przelewy z portfela do niego samego są pomijane. Jeżeli paczka
+    // jest niepoprawna, to zgłasza wyjątek i nie zmienia żadnego portfela.
+    // Paczki obejmujące rozłączne zbiory portfeli mogą być wykonywane
+    // współbieżnie.
+    static void transfer(const std::vector<Transfer> &batch);
+
+    // Wykonuje paczki przelewów równolegle. Paczki, które mają wspólne
+    // portfele, są wykonywane po kolei, w kolejności z batches. Niepoprawna
+    // paczka jest pomijana; po wykonaniu pozostałych zgłaszany jest wyjątek
+    // pierwszej niepoprawnej paczki.
+    static void transfer(const std::vector<std::vector<Transfer>> &batches);
+
+    // Zwraca indeks pierwszej operacji wykonanej nie wcześniej niż t, albo
+    // opSize(), jeśli takiej nie ma.
+    size_t lowerBound(std::chrono::system_clock::time_point t) const;
+
+    // Zwraca liczbę jednostek w portfelu w chwili t, czyli po ostatniej
+    // operacji wykonanej nie później niż t. Zwraca 0, jeśli wszystkie
+    // operacje wykonano po t. Po uporządkowaniu historii dla chwil sprzed
+    // zachowanej części zwraca stan z ostatniego usuniętego wpisu, a dla
+    // chwil wcześniejszych niż ten wpis zgłasza std::out_of_range, bo stan
+    // portfela w tych chwilach nie jest już znany.
+    uint64_t balanceAt(std::chrono::system_clock::time_point t) const;
+
+    // Zwraca operacje wykonane w przedziale czasu [a, b).
+    OperationRange operationsBetween(std::chrono::system_clock::time_point a,
+                                     std::chrono::system_clock::time_point b) const;
+
+    // Włącza rzadki indeks czasów zapamiętujący co stride-ty czas z historii,
+    // dzięki któremu wyszukiwanie po czasie w bardzo długich historiach
+    // przegląda głównie mały, ciągły indeks. Wartość 0 wyłącza indeks.
+    // Indeks przechodzi wraz z historią przy przenoszeniu portfela.
+    void enableTimeIndex(size_t stride);
+
+    // Ustawia zasadę przechowywania historii wszystkich portfeli. Historia jest
+    // porządkowana tylko przy wywołaniu compact(), nigdy przy dopisywaniu
+    // wpisów, więc operacje na portfelu (także przenoszenie) nie płacą za
+    // porządkowanie. Ostatni wpis jest zawsze zachowywany.
+    static void setRetentionPolicy(const RetentionPolicy &policy);
+
+    // Porządkuje historię portfela zgodnie z zasadą przechowywania. Należy ją
+    // wywoływać poza ścieżką krytyczną, np. okresowo dla długo żyjących
+    // portfeli.
+    void compact();
+
+    // Zwraca liczbę operacji wykonanych na portfelu (w zachowanej części
+    // historii).
     size_t opSize() const;
 
+    // Zwraca liczbę bajtów zajmowanych przez historię portfela (wraz
+    // z niewykorzystaną pojemnością bufora i indeksem czasów).
+    size_t historyBytes() const;
+
     // Zwraca k-tą operację na portfelu. Pod indeksem 0 powinna być najstarsza
-    // operacja. Przypisanie do w[k] powinno być zabronione na etapie kompilacji.
+    // (zachowana) operacja. Przypisanie do w[k] powinno być zabronione na
+    // etapie kompilacji.
     const Operation &operator[](size_t k) const;
 
 };
@@ -194,5 +484,30 @@ std::ostream &operator<<(std::ostream &os, const Wallet &b);
 // zgłoszone jako błąd kompilacji.
 const Wallet &Empty();
 
+// Literały portfeli, np.
+// Wallet w1 = 1.5_B;     // 1,5 B
+// Wallet w2 = 101_Bbin;  // 5 B
+// Literał jest sprawdzany i zamieniany na jednostki w czasie kompilacji;
+// niepoprawny literał lub przekraczający maxBC B powoduje błąd kompilacji.
+// Zapis binarny jest literałem liczbowym, bo C++17 nie pozwala przetwarzać
+// literałów napisowych w czasie kompilacji.
+template<char... cs>
+Wallet operator""_B() {
+    static constexpr char str[] = {cs..., '\0'};
+    constexpr uint64_t units = jnp_wallet_::parseString(str);
+    static_assert(units <= jnp_wallet_::maxBC * jnp_wallet_::decimalShift,
+                  "B literal exceeds the BC limit");
+    return Wallet::construct(units);
+}
+
+template<char... cs>
+Wallet operator""_Bbin() {
+    static constexpr char str[] = {cs..., '\0'};
+    constexpr uint64_t units = jnp_wallet_::parseBinaryString(str);
+    static_assert(units <= jnp_wallet_::maxBC * jnp_wallet_::decimalShift,
+                  "B literal exceeds the BC limit");
+    return Wallet::construct(units);
+}
+
 
 #endif // WALLET_H